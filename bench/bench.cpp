@@ -0,0 +1,364 @@
+#include <new>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "Lexer.h"
+#include "Parser.h"
+#include "Program.h"
+#include "Runtime.h"
+
+// benchmark harness (make bench): runs every workload on every engine in a
+// fresh process per run and prints, as JSON, the median wall time and
+// allocation count and the largest peak RSS
+//
+// usage: bench [--runs=N] [--workload=NAME] [--engine=NAME] [--dir=DIR]
+//              [--algen=PATH] [--baseline=FILE [--threshold=PERCENT]]
+// the parse engine only lexes and parses, and runs on huge programs from
+// algen (which the other engines could not type-check without recursing
+// too deeply)
+// with a baseline (earlier output of bench), workloads that got slower or
+// allocate more by more than the threshold are listed and the exit status is 1
+
+// every allocation made by the harness and libal
+std::atomic<long long> allocations{ 0 };
+
+void* operator new(size_t size) {
+	++allocations;
+	if (void* p = malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+namespace {
+
+struct Workload {
+	std::string name;
+	std::string text;
+	// only measured by the parse engine
+	bool parseOnly = false;
+};
+
+// compile options, as set by --no-opt, --memo and --parallel=N
+struct Engine {
+	std::string name;
+	bool optimize;
+	bool memoize;
+	bool parseOnly = false;
+	int threads = 1;
+};
+
+const std::vector<Engine> engines = {
+	{ "opt", true, false },
+	{ "no-opt", false, false },
+	{ "memo", true, true },
+	{ "parse", false, false, true },
+	// lexes workloads over Lexer::parallelThreshold in chunks
+	{ "parse-parallel", false, false, true, 4 },
+};
+
+// algen shapes that nest deeply, at a size that used to overflow the parser
+const std::vector<std::string> parseShapes = { "let-chain", "nested-fun", "wide-op" };
+const int parseSize = 100000;
+
+const std::vector<std::string> workloadFiles = { "fib", "collatz", "deep", "curried", "bigint" };
+
+// a long let chain with record-typed bindings (never used, so only checked)
+std::string large_let_program(int numBindings) {
+	std::ostringstream oss;
+	oss << "type point = { x: int, y: int };\n";
+	oss << "let v0 = 0 in\n";
+	for (int i = 1; i < numBindings; ++i) {
+		oss << "let p" << i << " = ({ x = " << i << ", y = v" << i - 1 << " } : point) in\n";
+		oss << "let v" << i << " = v" << i - 1 << " + " << i % 7 << " in\n";
+	}
+	oss << "v" << numBindings - 1 << "\n";
+	return oss.str();
+}
+
+// a long sum of calls, many of them repeated, for common subexpression
+// elimination to find
+std::string common_subexpr_program(int numTerms) {
+	std::ostringstream oss;
+	oss << "let g = fix g -> fun x -> if x < 1 then 0 else g (x - 1) in\n";
+	for (int i = 0; i < numTerms; ++i) {
+		oss << (i ? " + " : "") << "g (" << i % 50 << " + g " << i % 7 << ")";
+	}
+	oss << "\n";
+	return oss.str();
+}
+
+// measurements of one run, sent from the child process
+struct Sample {
+	bool ok;
+	long long compileNs;
+	long long runNs;
+	long long allocations;
+	long long peakRssKb;
+	long long tokens;
+};
+
+Sample run_once(const Workload& workload, const Engine& engine) {
+	Sample sample{};
+	int fds[2];
+	if (pipe(fds) != 0) {
+		return sample;
+	}
+	pid_t pid = fork();
+	if (pid == 0) {
+		close(fds[0]);
+		allocations = 0;
+		if (engine.threads > 1) {
+			Runtime::set_parallelism(engine.threads);
+		}
+		auto start = std::chrono::steady_clock::now();
+		bool ok;
+		long long tokens = 0;
+		std::chrono::steady_clock::time_point compiled;
+		if (engine.parseOnly) {
+			std::istringstream is(workload.text);
+			Source source(is, workload.name);
+			Lexer lexer(source);
+			std::deque<Token> lexed = lexer.get_tokens();
+			tokens = lexed.size();
+			Parser parser(std::move(lexed));
+			ok = parser.parse() && !source.has_errors();
+			compiled = std::chrono::steady_clock::now();
+		} else {
+			Program* program = Program::compile(workload.text, std::cerr, workload.name, engine.optimize, engine.memoize);
+			compiled = std::chrono::steady_clock::now();
+			ok = program && program->run(std::cerr);
+		}
+		auto done = std::chrono::steady_clock::now();
+		Sample result{
+			ok,
+			std::chrono::duration_cast<std::chrono::nanoseconds>(compiled - start).count(),
+			std::chrono::duration_cast<std::chrono::nanoseconds>(done - compiled).count(),
+			allocations.load(),
+			0,
+			tokens
+		};
+		if (write(fds[1], &result, sizeof(result)) != sizeof(result)) {
+			_exit(1);
+		}
+		_exit(0);
+	}
+	close(fds[1]);
+	bool received = pid > 0 && read(fds[0], &sample, sizeof(sample)) == sizeof(sample);
+	close(fds[0]);
+	int status = 0;
+	rusage usage{};
+	if (pid > 0) {
+		wait4(pid, &status, 0, &usage);
+	}
+	if (!received || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		sample.ok = false;
+	}
+	sample.peakRssKb = usage.ru_maxrss;
+	return sample;
+}
+
+template <typename T>
+T median(std::vector<T> values) {
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+struct Result {
+	std::string workload;
+	std::string engine;
+	bool ok = true;
+	double compileMs = 0;
+	double runMs = 0;
+	double totalMs = 0;
+	long long peakRssKb = 0;
+	long long allocations = 0;
+	long long tokens = 0;
+};
+
+// one JSON object per line, so baselines can be read back without a JSON parser
+void print_json(std::ostream& os, const std::vector<Result>& results, int runs) {
+	os << "[" << std::endl;
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result& r = results[i];
+		os << "  {\"workload\": \"" << r.workload << "\", \"engine\": \"" << r.engine << "\""
+		   << ", \"ok\": " << (r.ok ? "true" : "false") << ", \"runs\": " << runs
+		   << ", \"median_ms\": " << r.totalMs << ", \"compile_ms\": " << r.compileMs
+		   << ", \"run_ms\": " << r.runMs << ", \"peak_rss_kb\": " << r.peakRssKb
+		   << ", \"allocations\": " << r.allocations;
+		if (r.tokens > 0) {
+			os << ", \"tokens\": " << r.tokens << ", \"mtokens_per_s\": " << r.tokens / (r.compileMs * 1e3);
+		}
+		os << "}"
+		   << (i + 1 < results.size() ? "," : "") << std::endl;
+	}
+	os << "]" << std::endl;
+}
+
+std::string json_string(const std::string& line, const std::string& key) {
+	size_t pos = line.find("\"" + key + "\": \"");
+	if (pos == std::string::npos) { return ""; }
+	pos += key.size() + 5;
+	return line.substr(pos, line.find('"', pos) - pos);
+}
+
+double json_number(const std::string& line, const std::string& key) {
+	size_t pos = line.find("\"" + key + "\": ");
+	if (pos == std::string::npos) { return 0; }
+	return atof(line.c_str() + pos + key.size() + 4);
+}
+
+// baseline results keyed by workload and engine
+std::map<std::pair<std::string, std::string>, Result> read_baseline(std::istream& is) {
+	std::map<std::pair<std::string, std::string>, Result> baseline;
+	std::string line;
+	while (std::getline(is, line)) {
+		Result r;
+		r.workload = json_string(line, "workload");
+		r.engine = json_string(line, "engine");
+		if (r.workload.empty()) { continue; }
+		r.totalMs = json_number(line, "median_ms");
+		r.allocations = (long long)json_number(line, "allocations");
+		r.peakRssKb = (long long)json_number(line, "peak_rss_kb");
+		baseline[{ r.workload, r.engine }] = r;
+	}
+	return baseline;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	int runs = 5;
+	std::string dir = "bench";
+	std::string workloadFilter;
+	std::string engineFilter;
+	std::string baselinePath;
+	std::string algen = "./algen";
+	double threshold = 10;
+	for (int i = 1; i < argc; ++i) {
+		if (!strncmp(argv[i], "--runs=", 7)) {
+			runs = atoi(argv[i] + 7);
+		} else if (!strncmp(argv[i], "--workload=", 11)) {
+			workloadFilter = argv[i] + 11;
+		} else if (!strncmp(argv[i], "--engine=", 9)) {
+			engineFilter = argv[i] + 9;
+		} else if (!strncmp(argv[i], "--dir=", 6)) {
+			dir = argv[i] + 6;
+		} else if (!strncmp(argv[i], "--algen=", 8)) {
+			algen = argv[i] + 8;
+		} else if (!strncmp(argv[i], "--baseline=", 11)) {
+			baselinePath = argv[i] + 11;
+		} else if (!strncmp(argv[i], "--threshold=", 12)) {
+			threshold = atof(argv[i] + 12);
+		} else {
+			std::cerr << "Unknown option: " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+	if (runs < 1) {
+		std::cerr << "Invalid run count" << std::endl;
+		return 1;
+	}
+
+	std::vector<Workload> workloads;
+	for (const std::string& name : workloadFiles) {
+		std::ifstream ifs(dir + "/" + name + ".al");
+		if (!ifs) {
+			std::cerr << "Missing workload: " << dir << "/" << name << ".al" << std::endl;
+			return 1;
+		}
+		std::stringstream text;
+		text << ifs.rdbuf();
+		workloads.push_back({ name, text.str() });
+	}
+	workloads.push_back({ "large-let", large_let_program(200) });
+	workloads.push_back({ "common-subexpr", common_subexpr_program(150) });
+	for (const std::string& shape : parseShapes) {
+		std::string command = algen + " " + shape + " " + std::to_string(parseSize);
+		FILE* generator = popen(command.c_str(), "r");
+		std::string text;
+		char buffer[1 << 16];
+		size_t n;
+		while (generator && (n = fread(buffer, 1, sizeof(buffer), generator)) > 0) {
+			text.append(buffer, n);
+		}
+		if (!generator || pclose(generator) != 0) {
+			std::cerr << "Failed to run " << command << std::endl;
+			return 1;
+		}
+		workloads.push_back({ shape + "-" + std::to_string(parseSize), text, true });
+	}
+
+	std::vector<Result> results;
+	for (const Workload& workload : workloads) {
+		if (!workloadFilter.empty() && workload.name != workloadFilter) { continue; }
+		for (const Engine& engine : engines) {
+			if (!engineFilter.empty() && engine.name != engineFilter) { continue; }
+			if (workload.parseOnly != engine.parseOnly) { continue; }
+			std::vector<double> compileMs, runMs, totalMs;
+			std::vector<long long> allocs;
+			Result result;
+			result.workload = workload.name;
+			result.engine = engine.name;
+			for (int run = 0; run < runs; ++run) {
+				Sample sample = run_once(workload, engine);
+				result.ok = result.ok && sample.ok;
+				compileMs.push_back(sample.compileNs / 1e6);
+				runMs.push_back(sample.runNs / 1e6);
+				totalMs.push_back((sample.compileNs + sample.runNs) / 1e6);
+				allocs.push_back(sample.allocations);
+				result.tokens = sample.tokens;
+				result.peakRssKb = std::max(result.peakRssKb, sample.peakRssKb);
+			}
+			result.compileMs = median(compileMs);
+			result.runMs = median(runMs);
+			result.totalMs = median(totalMs);
+			result.allocations = median(allocs);
+			results.push_back(result);
+			std::cerr << workload.name << " / " << engine.name << ": " << result.totalMs << " ms" << std::endl;
+		}
+	}
+	print_json(std::cout, results, runs);
+
+	if (baselinePath.empty()) {
+		return 0;
+	}
+	std::ifstream ifs(baselinePath);
+	if (!ifs) {
+		std::cerr << "Invalid baseline path: " << baselinePath << std::endl;
+		return 1;
+	}
+	auto baseline = read_baseline(ifs);
+	int regressions = 0;
+	for (const Result& r : results) {
+		auto it = baseline.find({ r.workload, r.engine });
+		if (it == baseline.end()) { continue; }
+		const Result& base = it->second;
+		double timeChange = base.totalMs > 0 ? (r.totalMs / base.totalMs - 1) * 100 : 0;
+		double allocChange = base.allocations > 0 ? ((double)r.allocations / base.allocations - 1) * 100 : 0;
+		bool regressed = !r.ok || timeChange > threshold || allocChange > threshold;
+		regressions += regressed;
+		fprintf(stderr, "%-10s %-7s %10.2f ms (%+6.1f%%) %12lld allocations (%+6.1f%%)%s\n",
+		        r.workload.c_str(), r.engine.c_str(), r.totalMs, timeChange,
+		        r.allocations, allocChange, regressed ? "  REGRESSION" : "");
+	}
+	return regressions > 0 ? 1 : 0;
+}
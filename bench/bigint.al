@@ -0,0 +1,4 @@
+let fact = fix (fact : int -> int) -> fun n ->
+    if n = 0 then 1 else n * fact (n - 1)
+in
+fact 400 / fact 398
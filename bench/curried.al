@@ -0,0 +1,5 @@
+let add5 = fun (a : int) -> fun (b : int) -> fun (c : int) -> fun (d : int) -> fun (e : int) -> a + b + c + d + e in
+let loop = fix (loop : int -> int) -> fun n ->
+    if n = 0 then 0 else add5 n 1 2 3 4 % 7 + loop (n - 1)
+in
+loop 350
@@ -0,0 +1,4 @@
+let sum = fix (sum : int -> int) -> fun n ->
+    if n = 0 then 0 else n + sum (n - 1)
+in
+sum 300
@@ -0,0 +1,4 @@
+let fib = fix (fib : int -> int) -> fun n ->
+    if n < 2 then n else fib (n - 1) + fib (n - 2)
+in
+fib 16
@@ -0,0 +1,42 @@
+#!/bin/bash
+# Type-checking scaling benchmark on deeply nested annotated let/fun programs.
+# Generates programs of increasing depth and reports time per nesting level,
+# which stays flat when checking is linear in program size.
+# Usage: bench/nested_typecheck.sh [path/to/alc]
+
+ALC=${1:-./alc}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+# let f0 : int -> int = fun (a0 : int) -> let f1 ... in f1 a0 in f0 1
+gen_let() {
+	awk -v n="$1" 'BEGIN {
+		for (i = 0; i < n; ++i) printf "let f%d : int -> int = fun (a%d : int) ->\n", i, i
+		printf "a%d\n", n - 1
+		for (i = n - 1; i > 0; --i) printf "in f%d a%d\n", i, i - 1
+		print "in f0 1"
+	}'
+}
+
+# fun (x0 : int) -> fun (x1 : int) -> ... analyzed against an annotated type
+gen_fun() {
+	awk -v n="$1" 'BEGIN {
+		printf "let f : "
+		for (i = 0; i < n; ++i) printf "int -> "
+		print "int ="
+		for (i = 0; i < n; ++i) printf "fun (x%d : int) ->\n", i
+		print "x0 in f"
+	}'
+}
+
+printf "%-6s %8s %12s %14s\n" shape depth "time (ms)" "us per level"
+for shape in let fun; do
+	for depth in 125 250 500 1000; do
+		"gen_$shape" "$depth" > "$TMP/$shape$depth.al"
+		start=$(date +%s%N)
+		"$ALC" "$TMP/$shape$depth.al" --type > /dev/null || exit 1
+		end=$(date +%s%N)
+		ns=$((end - start))
+		awk -v s="$shape" -v d="$depth" -v ns="$ns" 'BEGIN { printf "%-6s %8d %12.2f %14.3f\n", s, d, ns / 1e6, ns / 1e3 / d }'
+	done
+done
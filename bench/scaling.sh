@@ -0,0 +1,49 @@
+#!/bin/bash
+# Front-end scaling report: generates programs of each algen shape at
+# doubling sizes, times lexing, parsing and type checking (alc --stats=json)
+# and fits time ~ size^k per phase by least squares on log-log points.
+# k near 1 is linear; k above 1.25 is flagged as superlinear.
+# Usage: bench/scaling.sh [path/to/alc] [path/to/algen] [sizes...]
+
+ALC=${1:-./alc}
+ALGEN=${2:-./algen}
+shift 2 2>/dev/null
+SIZES=${*:-500 1000 2000 4000 8000}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+phase_ms() {
+	sed -n "s/.*\"$1\": \([0-9.e+-]*\).*/\1/p" "$2"
+}
+
+printf "%-11s %7s %10s %10s %10s\n" shape size "lex ms" "parse ms" "check ms"
+for shape in let-chain wide-op nested-fun records comments; do
+	: > "$TMP/points"
+	for size in $SIZES; do
+		"$ALGEN" "$shape" "$size" > "$TMP/program.al" || exit 1
+		if ! "$ALC" "$TMP/program.al" --type --stats=json > /dev/null 2> "$TMP/stats"; then
+			printf "%-11s %7d %10s\n" "$shape" "$size" "crashed"
+			continue
+		fi
+		lex=$(phase_ms lex "$TMP/stats")
+		parse=$(phase_ms parse "$TMP/stats")
+		check=$(phase_ms typecheck "$TMP/stats")
+		printf "%-11s %7d %10.2f %10.2f %10.2f\n" "$shape" "$size" "$lex" "$parse" "$check"
+		echo "$size $lex $parse $check" >> "$TMP/points"
+	done
+	awk -v shape="$shape" '
+		# phases under 0.5 ms are mostly noise and are not fitted
+		{ for (p = 2; p <= 4; ++p) if ($p >= 0.5) { x = log($1); y = log($p); n[p]++; sx[p] += x; sy[p] += y; sxx[p] += x * x; sxy[p] += x * y } }
+		END {
+			split("lex parse check", names, " ")
+			line = sprintf("%-11s %7s", shape, "fit k")
+			flags = ""
+			for (p = 2; p <= 4; ++p) {
+				if (n[p] < 2) { line = line sprintf(" %10s", "-"); continue }
+				k = (n[p] * sxy[p] - sx[p] * sy[p]) / (n[p] * sxx[p] - sx[p] * sx[p])
+				line = line sprintf(" %10.2f", k)
+				if (k > 1.25) flags = flags " " names[p - 1]
+			}
+			print line (flags != "" ? "  superlinear:" flags : "")
+		}' "$TMP/points"
+done
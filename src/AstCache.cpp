@@ -0,0 +1,645 @@
+#include <cstdlib>
+#include <optional>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "AstCache.h"
+#include "expr/EBinaryOp.h"
+#include "expr/EBoolLit.h"
+#include "expr/EFix.h"
+#include "expr/EFloatLit.h"
+#include "expr/EFun.h"
+#include "expr/EFunAp.h"
+#include "expr/EIf.h"
+#include "expr/EIntLit.h"
+#include "expr/ELet.h"
+#include "expr/ERecordLit.h"
+#include "expr/EUnaryOp.h"
+#include "expr/EUnitLit.h"
+#include "expr/EVar.h"
+
+std::string AstCache::directory;
+
+namespace {
+
+// bump when the artifact layout changes
+const uint32_t formatVersion = 2;
+const char magic[4] = { 'A', 'L', 'B', 'C' };
+// artifacts are written in host byte order; a foreign one fails this check
+const uint32_t byteOrderMark = 0x01020304;
+// index of an absent type (no annotation, unchecked node, payload-less case)
+const uint32_t none = 0xFFFFFFFF;
+
+enum class NodeKind : uint8_t {
+	IntLit, FloatLit, BoolLit, UnitLit, Var, Fun, Fix, FunAp, If, Let, BinaryOp, UnaryOp, RecordLit,
+	// an int literal too large for a long long, in decimal
+	BigIntLit
+};
+
+enum class TypeKind : uint8_t {
+	Base, Arrow, Tuple, Variant, Record, Var
+};
+
+class Writer {
+public:
+	std::string out;
+
+	template <typename T>
+	void put(T value) {
+		out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+};
+
+class Reader {
+public:
+	const char* pos;
+	const char* end;
+	// cleared by any read past the end; callers check it once per record
+	bool ok = true;
+
+	Reader(const char* begin, const char* end) : pos(begin), end(end) {}
+
+	template <typename T>
+	T get() {
+		T value{};
+		if ((size_t)(end - pos) < sizeof(T)) {
+			ok = false;
+			return value;
+		}
+		memcpy(&value, pos, sizeof(T));
+		pos += sizeof(T);
+		return value;
+	}
+};
+
+class Encoder {
+public:
+	Writer strings;
+	Writer types;
+	Writer nodes;
+	uint32_t numStrings = 0;
+	uint32_t numTypes = 0;
+	uint32_t numNodes = 0;
+
+	void encode(Expr* ast) {
+		// iterative postorder, so deep programs do not exhaust the native stack
+		std::vector<std::pair<Expr*, bool>> stack{ { ast, false } };
+		std::vector<uint32_t> results;
+		while (!stack.empty()) {
+			Expr* expr = stack.back().first;
+			if (!stack.back().second) {
+				stack.back().second = true;
+				std::vector<Expr*> children;
+				expr->for_each_child([&](Expr*& child) {
+					children.push_back(child);
+				});
+				for (auto it = children.rbegin(); it != children.rend(); ++it) {
+					stack.push_back({ *it, false });
+				}
+				continue;
+			}
+			stack.pop_back();
+			size_t numChildren = 0;
+			expr->for_each_child([&](Expr*&) {
+				++numChildren;
+			});
+			std::vector<uint32_t> children(results.end() - numChildren, results.end());
+			results.resize(results.size() - numChildren);
+			encode_node(expr, children);
+			results.push_back(numNodes++);
+		}
+	}
+
+private:
+	std::unordered_map<std::string, uint32_t> stringIds;
+	std::unordered_map<const Type*, uint32_t> typeIds;
+
+	uint32_t string_id(const std::string& str) {
+		auto it = stringIds.find(str);
+		if (it != stringIds.end()) { return it->second; }
+		strings.put<uint32_t>(str.size());
+		strings.out += str;
+		stringIds.emplace(str, numStrings);
+		return numStrings++;
+	}
+
+	uint32_t type_id(const Type* type) {
+		if (!type) { return none; }
+		type = Type::resolve(type);
+		auto it = typeIds.find(type);
+		if (it != typeIds.end()) { return it->second; }
+		// component types are written first (types are acyclic)
+		if (const TVar* var = type->as<TVar>()) {
+			types.put(TypeKind::Var);
+			types.put<uint32_t>(var->level);
+		} else if (const TArrow* arrow = type->as<TArrow>()) {
+			uint32_t left = type_id(arrow->left);
+			uint32_t right = type_id(arrow->right);
+			types.put(TypeKind::Arrow);
+			types.put(left);
+			types.put(right);
+		} else if (const TTuple* tuple = type->as<TTuple>()) {
+			std::vector<uint32_t> elements;
+			for (const Type* element : tuple->types) {
+				elements.push_back(type_id(element));
+			}
+			types.put(TypeKind::Tuple);
+			types.put<uint32_t>(elements.size());
+			for (uint32_t element : elements) {
+				types.put(element);
+			}
+		} else if (const TVariant* variant = type->as<TVariant>()) {
+			std::vector<uint32_t> caseTypes;
+			for (const TVariant::Case& c : variant->cases) {
+				caseTypes.push_back(type_id(c.type));
+			}
+			types.put(TypeKind::Variant);
+			types.put(string_id(variant->name));
+			types.put<uint32_t>(variant->cases.size());
+			for (size_t i = 0; i < variant->cases.size(); ++i) {
+				types.put(string_id(variant->cases[i].tag));
+				types.put(caseTypes[i]);
+			}
+		} else if (const TRecord* record = type->as<TRecord>()) {
+			std::vector<uint32_t> fieldTypes;
+			for (const std::string& ident : record->idents) {
+				fieldTypes.push_back(type_id(record->fields.at(ident)));
+			}
+			types.put(TypeKind::Record);
+			types.put(string_id(record->name));
+			types.put<uint32_t>(record->idents.size());
+			for (size_t i = 0; i < record->idents.size(); ++i) {
+				types.put(string_id(record->idents[i]));
+				types.put(fieldTypes[i]);
+			}
+		} else if (const TBase* base = type->as<TBase>()) {
+			types.put(TypeKind::Base);
+			types.put(string_id(base->name));
+		} else {
+			throw std::runtime_error("AstCache: unknown type");
+		}
+		typeIds.emplace(type, numTypes);
+		return numTypes++;
+	}
+
+	void encode_location(const Location& loc) {
+		nodes.put<uint32_t>(loc.line);
+		nodes.put<uint32_t>(loc.colStart);
+	}
+
+	void encode_binder(const EVar* ident) {
+		nodes.put(string_id(ident->value));
+		nodes.put(type_id(ident->typeAnn));
+		encode_location(ident->loc);
+	}
+
+	void encode_token(const Token& token) {
+		nodes.put<uint32_t>((uint32_t)token.type);
+		nodes.put(string_id(token.value));
+		encode_location(token.loc);
+	}
+
+	void encode_header(NodeKind kind, const Expr* expr) {
+		nodes.put(kind);
+		encode_location(expr->loc);
+		nodes.put(type_id(expr->typeAnn));
+		nodes.put(type_id(expr->synType));
+	}
+
+	void encode_node(const Expr* expr, const std::vector<uint32_t>& children) {
+		if (const EIntLit* e = expr->as<EIntLit>()) {
+			if (e->big) {
+				encode_header(NodeKind::BigIntLit, e);
+				nodes.put(string_id(e->big->to_string()));
+			} else {
+				encode_header(NodeKind::IntLit, e);
+				nodes.put<int64_t>(e->value);
+			}
+		} else if (const EFloatLit* e = expr->as<EFloatLit>()) {
+			encode_header(NodeKind::FloatLit, e);
+			nodes.put<double>(e->value);
+		} else if (const EBoolLit* e = expr->as<EBoolLit>()) {
+			encode_header(NodeKind::BoolLit, e);
+			nodes.put<uint8_t>(e->value);
+		} else if (expr->as<EUnitLit>()) {
+			encode_header(NodeKind::UnitLit, expr);
+		} else if (const EVar* e = expr->as<EVar>()) {
+			encode_header(NodeKind::Var, e);
+			nodes.put(string_id(e->value));
+		} else if (const EFun* e = expr->as<EFun>()) {
+			encode_header(NodeKind::Fun, e);
+			encode_binder(e->ident);
+		} else if (const EFix* e = expr->as<EFix>()) {
+			encode_header(NodeKind::Fix, e);
+			encode_binder(e->ident);
+		} else if (expr->as<EFunAp>()) {
+			encode_header(NodeKind::FunAp, expr);
+		} else if (expr->as<EIf>()) {
+			encode_header(NodeKind::If, expr);
+		} else if (const ELet* e = expr->as<ELet>()) {
+			encode_header(NodeKind::Let, e);
+			encode_binder(e->ident);
+			nodes.put<uint8_t>(e->strict);
+		} else if (const EBinaryOp* e = expr->as<EBinaryOp>()) {
+			encode_header(NodeKind::BinaryOp, e);
+			encode_token(e->op);
+		} else if (const EUnaryOp* e = expr->as<EUnaryOp>()) {
+			encode_header(NodeKind::UnaryOp, e);
+			encode_token(e->op);
+		} else if (const ERecordLit* e = expr->as<ERecordLit>()) {
+			encode_header(NodeKind::RecordLit, e);
+			nodes.put<uint32_t>(e->idents.size());
+			for (const std::string& ident : e->idents) {
+				nodes.put(string_id(ident));
+			}
+		} else {
+			throw std::runtime_error("AstCache: unknown expression");
+		}
+		for (uint32_t child : children) {
+			nodes.put(child);
+		}
+	}
+};
+
+class Decoder {
+public:
+	Decoder(const char* begin, const char* end, const Source& source)
+		: in(begin, end), source(source) {}
+
+	// returns nullptr if the artifact is malformed
+	Expr* decode() {
+		uint32_t numStrings = in.get<uint32_t>();
+		for (uint32_t i = 0; i < numStrings && in.ok; ++i) {
+			uint32_t size = in.get<uint32_t>();
+			if ((size_t)(in.end - in.pos) < size) { return nullptr; }
+			strings.emplace_back(in.pos, size);
+			in.pos += size;
+		}
+		uint32_t numTypes = in.get<uint32_t>();
+		for (uint32_t i = 0; i < numTypes && in.ok; ++i) {
+			const Type* type = decode_type();
+			if (!type) { return nullptr; }
+			types.push_back(type);
+		}
+		uint32_t numNodes = in.get<uint32_t>();
+		for (uint32_t i = 0; i < numNodes && in.ok; ++i) {
+			Expr* expr = decode_node();
+			if (!expr) { return nullptr; }
+			nodes.push_back(expr);
+		}
+		if (!in.ok || nodes.empty() || in.pos != in.end) { return nullptr; }
+		// the program type is recorded on the root
+		if (!nodes.back()->synType) { return nullptr; }
+		return nodes.back();
+	}
+
+private:
+	Reader in;
+	const Source& source;
+	std::vector<std::string> strings;
+	std::vector<const Type*> types;
+	std::vector<Expr*> nodes;
+
+	const std::string* get_string() {
+		uint32_t id = in.get<uint32_t>();
+		return id < strings.size() ? &strings[id] : nullptr;
+	}
+
+	// absent types decode to nullptr; ok is cleared for invalid indices
+	const Type* get_type() {
+		uint32_t id = in.get<uint32_t>();
+		if (id == none) { return nullptr; }
+		if (id >= types.size()) {
+			in.ok = false;
+			return nullptr;
+		}
+		return types[id];
+	}
+
+	Expr* get_child() {
+		uint32_t id = in.get<uint32_t>();
+		if (id >= nodes.size()) {
+			in.ok = false;
+			return nullptr;
+		}
+		return nodes[id];
+	}
+
+	Location get_location() {
+		int line = in.get<uint32_t>();
+		int col = in.get<uint32_t>();
+		return { &source, line, col, col };
+	}
+
+	const Type* decode_type() {
+		TypeKind kind = in.get<TypeKind>();
+		switch (kind) {
+		case TypeKind::Base: {
+			const std::string* name = get_string();
+			if (!name) { return nullptr; }
+			// builtin types are singletons
+			for (const Type* builtin : { Type::Int(), Type::Float(), Type::Bool(), Type::Unit() }) {
+				if (builtin->as<TBase>()->name == *name) { return builtin; }
+			}
+			return new TBase(*name);
+		}
+		case TypeKind::Arrow: {
+			const Type* left = get_type();
+			const Type* right = get_type();
+			if (!left || !right) { return nullptr; }
+			return new TArrow(left, right);
+		}
+		case TypeKind::Tuple: {
+			uint32_t size = in.get<uint32_t>();
+			std::vector<const Type*> elements;
+			for (uint32_t i = 0; i < size && in.ok; ++i) {
+				elements.push_back(get_type());
+				if (!elements.back()) { return nullptr; }
+			}
+			return in.ok ? new TTuple(std::move(elements)) : nullptr;
+		}
+		case TypeKind::Variant: {
+			const std::string* name = get_string();
+			uint32_t size = in.get<uint32_t>();
+			std::vector<TVariant::Case> cases;
+			for (uint32_t i = 0; i < size && in.ok; ++i) {
+				const std::string* tag = get_string();
+				if (!tag) { return nullptr; }
+				cases.push_back({ *tag, get_type() });
+			}
+			if (!name || !in.ok) { return nullptr; }
+			return new TVariant(*name, std::move(cases));
+		}
+		case TypeKind::Record: {
+			const std::string* name = get_string();
+			uint32_t size = in.get<uint32_t>();
+			std::vector<TRecord::Field> fields;
+			for (uint32_t i = 0; i < size && in.ok; ++i) {
+				const std::string* ident = get_string();
+				const Type* type = get_type();
+				if (!ident || !type) { return nullptr; }
+				fields.push_back({ *ident, type });
+			}
+			if (!name || !in.ok) { return nullptr; }
+			return new TRecord(*name, fields);
+		}
+		case TypeKind::Var: {
+			const TVar* var = TVar::fresh();
+			var->level = in.get<uint32_t>();
+			return var;
+		}
+		}
+		return nullptr;
+	}
+
+	EVar* decode_binder() {
+		const std::string* name = get_string();
+		const Type* typeAnn = get_type();
+		Location loc = get_location();
+		if (!name) { return nullptr; }
+		return new EVar(loc, typeAnn, *name);
+	}
+
+	std::optional<Token> decode_token() {
+		TokenType type = (TokenType)in.get<uint32_t>();
+		const std::string* value = get_string();
+		Location loc = get_location();
+		if (!value) { return std::nullopt; }
+		return Token{ loc, type, *value };
+	}
+
+	Expr* decode_node() {
+		NodeKind kind = in.get<NodeKind>();
+		Location loc = get_location();
+		const Type* typeAnn = get_type();
+		const Type* synType = get_type();
+		Expr* expr = nullptr;
+		switch (kind) {
+		case NodeKind::IntLit:
+			expr = new EIntLit(loc, typeAnn, in.get<int64_t>());
+			break;
+		case NodeKind::BigIntLit: {
+			const std::string* digits = get_string();
+			BigInt big;
+			if (!digits || !BigInt::parse(*digits, big)) { return nullptr; }
+			expr = new EIntLit(loc, typeAnn, 0, new BigInt(big));
+			break;
+		}
+		case NodeKind::FloatLit:
+			expr = new EFloatLit(loc, typeAnn, in.get<double>());
+			break;
+		case NodeKind::BoolLit:
+			expr = new EBoolLit(loc, typeAnn, in.get<uint8_t>());
+			break;
+		case NodeKind::UnitLit:
+			expr = new EUnitLit(loc, typeAnn);
+			break;
+		case NodeKind::Var: {
+			const std::string* name = get_string();
+			if (!name) { return nullptr; }
+			expr = new EVar(loc, typeAnn, *name);
+			break;
+		}
+		case NodeKind::Fun:
+		case NodeKind::Fix: {
+			EVar* ident = decode_binder();
+			Expr* body = get_child();
+			if (!ident || !body) { return nullptr; }
+			if (kind == NodeKind::Fun) {
+				expr = new EFun(loc, typeAnn, ident, body);
+			} else {
+				expr = new EFix(loc, typeAnn, ident, body);
+			}
+			break;
+		}
+		case NodeKind::FunAp: {
+			Expr* fun = get_child();
+			Expr* arg = get_child();
+			if (!fun || !arg) { return nullptr; }
+			expr = new EFunAp(loc, typeAnn, fun, arg);
+			break;
+		}
+		case NodeKind::If: {
+			Expr* test = get_child();
+			Expr* body = get_child();
+			Expr* elseBody = get_child();
+			if (!test || !body || !elseBody) { return nullptr; }
+			expr = new EIf(loc, typeAnn, test, body, elseBody);
+			break;
+		}
+		case NodeKind::Let: {
+			EVar* ident = decode_binder();
+			bool strict = in.get<uint8_t>();
+			Expr* value = get_child();
+			Expr* body = get_child();
+			if (!ident || !value || !body) { return nullptr; }
+			expr = new ELet(loc, typeAnn, ident, value, body, strict);
+			break;
+		}
+		case NodeKind::BinaryOp: {
+			std::optional<Token> op = decode_token();
+			Expr* left = get_child();
+			Expr* right = get_child();
+			if (!op || !left || !right) { return nullptr; }
+			expr = new EBinaryOp(loc, typeAnn, left, *op, right);
+			break;
+		}
+		case NodeKind::UnaryOp: {
+			std::optional<Token> op = decode_token();
+			Expr* right = get_child();
+			if (!op || !right) { return nullptr; }
+			expr = new EUnaryOp(loc, typeAnn, *op, right);
+			break;
+		}
+		case NodeKind::RecordLit: {
+			uint32_t size = in.get<uint32_t>();
+			std::vector<const std::string*> idents;
+			for (uint32_t i = 0; i < size && in.ok; ++i) {
+				idents.push_back(get_string());
+				if (!idents.back()) { return nullptr; }
+			}
+			std::vector<ERecordLit::Field> fields;
+			for (uint32_t i = 0; i < size && in.ok; ++i) {
+				Expr* field = get_child();
+				if (!field) { return nullptr; }
+				fields.push_back({ *idents[i], field });
+			}
+			if (!in.ok) { return nullptr; }
+			expr = new ERecordLit(loc, typeAnn, fields);
+			break;
+		}
+		default:
+			return nullptr;
+		}
+		if (!in.ok) { return nullptr; }
+		expr->synType = synType;
+		return expr;
+	}
+};
+
+// distinguishes builds of alc (a rebuilt compiler may check programs differently);
+// the Makefile sets BUILD_STAMP to a checksum of the other objects
+#ifndef BUILD_STAMP
+#define BUILD_STAMP __DATE__ " " __TIME__
+#endif
+const char* buildStamp = BUILD_STAMP;
+
+uint64_t source_size(const Source& source) {
+	uint64_t size = 0;
+	for (const std::string& line : source.lines) {
+		size += line.size() + 1;
+	}
+	return size;
+}
+
+}
+
+std::string AstCache::default_directory() {
+	if (const char* dir = getenv("ALC_CACHE_DIR")) {
+		return dir;
+	}
+	if (const char* home = getenv("HOME")) {
+		return std::string(home) + "/.cache/alc";
+	}
+	return ".alc-cache";
+}
+
+uint64_t AstCache::fnv1a(const char* data, size_t size, uint64_t hash) {
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= (unsigned char)data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+uint64_t AstCache::hash(const Source& source) {
+	uint64_t hash = fnv1a(buildStamp, strlen(buildStamp));
+	for (const std::string& line : source.lines) {
+		hash = fnv1a(line.data(), line.size(), hash);
+		hash = fnv1a("\n", 1, hash);
+	}
+	return hash;
+}
+
+std::string AstCache::path(uint64_t hash) {
+	std::ostringstream oss;
+	oss << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".alb";
+	return oss.str();
+}
+
+Expr* AstCache::load(const Source& source) {
+	uint64_t key = hash(source);
+	int fd = open(path(key).c_str(), O_RDONLY);
+	if (fd < 0) { return nullptr; }
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return nullptr;
+	}
+	void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) { return nullptr; }
+	const char* begin = static_cast<const char*>(data);
+	Reader header(begin, begin + st.st_size);
+	char fileMagic[4];
+	for (char& c : fileMagic) {
+		c = header.get<char>();
+	}
+	Expr* ast = nullptr;
+	// the source size guards against hash collisions
+	if (!memcmp(fileMagic, magic, 4)
+	    && header.get<uint32_t>() == formatVersion
+	    && header.get<uint32_t>() == byteOrderMark
+	    && header.get<uint64_t>() == key
+	    && header.get<uint64_t>() == source_size(source)
+	    && header.ok) {
+		ast = Decoder(header.pos, header.end, source).decode();
+	}
+	munmap(data, st.st_size);
+	return ast;
+}
+
+void AstCache::store(const Source& source, Expr* ast) {
+	Encoder encoder;
+	encoder.encode(ast);
+	Writer out;
+	out.out.append(magic, 4);
+	out.put(formatVersion);
+	out.put(byteOrderMark);
+	uint64_t key = hash(source);
+	out.put(key);
+	out.put(source_size(source));
+	out.put(encoder.numStrings);
+	out.out += encoder.strings.out;
+	out.put(encoder.numTypes);
+	out.out += encoder.types.out;
+	out.put(encoder.numNodes);
+	out.out += encoder.nodes.out;
+	write_file(path(key), out.out);
+}
+
+bool AstCache::write_file(const std::string& path, const std::string& data) {
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+	// the thread id keeps concurrent writers in one process apart
+	std::ostringstream temp;
+	temp << path << ".tmp" << getpid() << "-" << std::this_thread::get_id();
+	{
+		std::ofstream ofs(temp.str(), std::ios::binary);
+		if (!ofs.write(data.data(), data.size())) {
+			std::filesystem::remove(temp.str(), error);
+			return false;
+		}
+	}
+	std::filesystem::rename(temp.str(), path, error);
+	if (error) {
+		std::filesystem::remove(temp.str(), error);
+		return false;
+	}
+	return true;
+}
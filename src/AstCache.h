@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include "Expr.h"
+#include "Source.h"
+
+// on-disk cache of type-checked programs (--cache)
+// an artifact is keyed by a content hash of the source and holds a string
+// table, a type table and the AST in postorder, with children and types
+// referenced by index; it is position-independent and decoded straight
+// out of an mmap, so a cached run skips lexing, parsing and type checking
+class AstCache {
+public:
+	// directory holding artifacts; empty disables the cache
+	static std::string directory;
+
+	// $ALC_CACHE_DIR, else $HOME/.cache/alc, else .alc-cache
+	static std::string default_directory();
+
+	// FNV-1a hash of the source text (and of the compiler build, so that
+	// artifacts written by another alc are never reused)
+	static uint64_t hash(const Source& source);
+
+	// returns the cached AST of source, with the type checker's types recorded
+	// on its nodes (the root's synType is the program type); nullptr on a miss
+	// or if the artifact is unreadable
+	static Expr* load(const Source& source);
+
+	// writes the artifact for a type-checked ast; errors are ignored (the
+	// cache is only an optimization)
+	static void store(const Source& source, Expr* ast);
+
+	static uint64_t fnv1a(const char* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL);
+
+	// writes data to a temporary file and renames it to path (creating its
+	// directory), so concurrent readers never see a partial file
+	static bool write_file(const std::string& path, const std::string& data);
+
+private:
+	static std::string path(uint64_t hash);
+};
@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <stdexcept>
+#include "BigInt.h"
+
+BigInt::BigInt(long long value) : negative(value < 0) {
+	uint64_t magnitude = negative ? 0 - (uint64_t)value : (uint64_t)value;
+	if (magnitude) { limbs.push_back((uint32_t)magnitude); }
+	if (magnitude >> 32) { limbs.push_back((uint32_t)(magnitude >> 32)); }
+}
+
+BigInt::BigInt(Limbs limbs, bool negative) : limbs(std::move(limbs)) {
+	trim(this->limbs);
+	this->negative = negative && !this->limbs.empty();
+}
+
+bool BigInt::parse(const std::string& str, BigInt& result) {
+	size_t start = !str.empty() && str[0] == '-';
+	if (start == str.size()) { return false; }
+	Limbs limbs;
+	// nine digits at a time, which fit in a limb
+	for (size_t i = start; i < str.size(); i += 9) {
+		size_t end = std::min(i + 9, str.size());
+		uint32_t chunk = 0;
+		uint32_t scale = 1;
+		for (size_t j = i; j < end; ++j) {
+			if (str[j] < '0' || str[j] > '9') { return false; }
+			chunk = chunk * 10 + (str[j] - '0');
+			scale *= 10;
+		}
+		uint64_t carry = chunk;
+		for (uint32_t& limb : limbs) {
+			uint64_t cur = (uint64_t)limb * scale + carry;
+			limb = (uint32_t)cur;
+			carry = cur >> 32;
+		}
+		if (carry) { limbs.push_back((uint32_t)carry); }
+	}
+	result = BigInt(std::move(limbs), start == 1);
+	return true;
+}
+
+bool BigInt::fits_long_long() const {
+	if (limbs.size() > 2) { return false; }
+	uint64_t magnitude = 0;
+	for (size_t i = limbs.size(); i-- > 0;) {
+		magnitude = magnitude << 32 | limbs[i];
+	}
+	return negative ? magnitude <= (uint64_t)1 << 63 : magnitude < (uint64_t)1 << 63;
+}
+
+long long BigInt::to_long_long() const {
+	uint64_t magnitude = 0;
+	for (size_t i = std::min(limbs.size(), (size_t)2); i-- > 0;) {
+		magnitude = magnitude << 32 | limbs[i];
+	}
+	return negative ? (long long)(0 - magnitude) : (long long)magnitude;
+}
+
+std::string BigInt::to_string() const {
+	if (limbs.empty()) { return "0"; }
+	// nine digits at a time, least significant first
+	std::vector<uint32_t> chunks;
+	Limbs magnitude = limbs;
+	while (!magnitude.empty()) {
+		chunks.push_back(divide_small(magnitude, 1000000000));
+	}
+	std::string str = negative ? "-" : "";
+	str += std::to_string(chunks.back());
+	for (size_t i = chunks.size() - 1; i-- > 0;) {
+		std::string digits = std::to_string(chunks[i]);
+		str += std::string(9 - digits.size(), '0') + digits;
+	}
+	return str;
+}
+
+BigInt BigInt::operator-() const {
+	return BigInt(limbs, !negative);
+}
+
+BigInt operator+(const BigInt& a, const BigInt& b) {
+	if (a.negative == b.negative) {
+		return BigInt(BigInt::add(a.limbs, b.limbs), a.negative);
+	}
+	if (BigInt::compare(a.limbs, b.limbs) >= 0) {
+		return BigInt(BigInt::subtract(a.limbs, b.limbs), a.negative);
+	}
+	return BigInt(BigInt::subtract(b.limbs, a.limbs), b.negative);
+}
+
+BigInt operator-(const BigInt& a, const BigInt& b) {
+	return a + -b;
+}
+
+BigInt operator*(const BigInt& a, const BigInt& b) {
+	return BigInt(BigInt::multiply(a.limbs, b.limbs), a.negative != b.negative);
+}
+
+BigInt operator/(const BigInt& a, const BigInt& b) {
+	BigInt quotient, remainder;
+	BigInt::div_mod(a, b, quotient, remainder);
+	return quotient;
+}
+
+BigInt operator%(const BigInt& a, const BigInt& b) {
+	BigInt quotient, remainder;
+	BigInt::div_mod(a, b, quotient, remainder);
+	return remainder;
+}
+
+bool operator==(const BigInt& a, const BigInt& b) {
+	return a.negative == b.negative && a.limbs == b.limbs;
+}
+
+bool operator<(const BigInt& a, const BigInt& b) {
+	if (a.negative != b.negative) { return a.negative; }
+	int order = BigInt::compare(a.limbs, b.limbs);
+	return a.negative ? order > 0 : order < 0;
+}
+
+void BigInt::trim(Limbs& limbs) {
+	while (!limbs.empty() && limbs.back() == 0) {
+		limbs.pop_back();
+	}
+}
+
+int BigInt::compare(const Limbs& a, const Limbs& b) {
+	if (a.size() != b.size()) { return a.size() < b.size() ? -1 : 1; }
+	for (size_t i = a.size(); i-- > 0;) {
+		if (a[i] != b[i]) { return a[i] < b[i] ? -1 : 1; }
+	}
+	return 0;
+}
+
+BigInt::Limbs BigInt::add(const Limbs& a, const Limbs& b) {
+	Limbs sum = a;
+	add_shifted(sum, b, 0);
+	return sum;
+}
+
+BigInt::Limbs BigInt::subtract(const Limbs& a, const Limbs& b) {
+	Limbs difference = a;
+	int64_t borrow = 0;
+	for (size_t i = 0; i < a.size(); ++i) {
+		if (i >= b.size() && !borrow) { break; }
+		int64_t cur = (int64_t)a[i] - (i < b.size() ? b[i] : 0) - borrow;
+		borrow = cur < 0;
+		difference[i] = (uint32_t)cur;
+	}
+	trim(difference);
+	return difference;
+}
+
+void BigInt::add_shifted(Limbs& a, const Limbs& b, size_t shift) {
+	if (b.empty()) { return; }
+	if (a.size() < shift + b.size()) {
+		a.resize(shift + b.size(), 0);
+	}
+	uint64_t carry = 0;
+	for (size_t i = 0; i < b.size() || carry; ++i) {
+		if (shift + i == a.size()) {
+			a.push_back(0);
+		}
+		uint64_t cur = (uint64_t)a[shift + i] + (i < b.size() ? b[i] : 0) + carry;
+		a[shift + i] = (uint32_t)cur;
+		carry = cur >> 32;
+	}
+}
+
+BigInt::Limbs BigInt::multiply(const Limbs& a, const Limbs& b) {
+	return karatsuba(a, b);
+}
+
+BigInt::Limbs BigInt::schoolbook(const Limbs& a, const Limbs& b) {
+	if (a.empty() || b.empty()) { return {}; }
+	Limbs product(a.size() + b.size(), 0);
+	for (size_t i = 0; i < a.size(); ++i) {
+		uint64_t carry = 0;
+		for (size_t j = 0; j < b.size(); ++j) {
+			uint64_t cur = (uint64_t)a[i] * b[j] + product[i + j] + carry;
+			product[i + j] = (uint32_t)cur;
+			carry = cur >> 32;
+		}
+		product[i + b.size()] = (uint32_t)carry;
+	}
+	trim(product);
+	return product;
+}
+
+BigInt::Limbs BigInt::karatsuba(const Limbs& a, const Limbs& b) {
+	if (a.size() > b.size()) { return karatsuba(b, a); }
+	if (a.size() < karatsubaThreshold) { return schoolbook(a, b); }
+	if (2 * a.size() <= b.size()) {
+		// unbalanced: multiply by pieces of b as long as a
+		Limbs product;
+		for (size_t i = 0; i < b.size(); i += a.size()) {
+			Limbs piece(b.begin() + i, b.begin() + std::min(i + a.size(), b.size()));
+			trim(piece);
+			add_shifted(product, karatsuba(a, piece), i);
+		}
+		return product;
+	}
+	// a = a1 * 2^(32 * half) + a0, and so b; three half-size products
+	size_t half = b.size() / 2;
+	Limbs a0(a.begin(), a.begin() + half);
+	Limbs a1(a.begin() + half, a.end());
+	Limbs b0(b.begin(), b.begin() + half);
+	Limbs b1(b.begin() + half, b.end());
+	trim(a0);
+	trim(b0);
+	Limbs z0 = karatsuba(a0, b0);
+	Limbs z2 = karatsuba(a1, b1);
+	// (a0 + a1)(b0 + b1) - z0 - z2 = a0 * b1 + a1 * b0
+	Limbs z1 = subtract(subtract(karatsuba(add(a0, a1), add(b0, b1)), z0), z2);
+	Limbs product = std::move(z0);
+	add_shifted(product, z1, half);
+	add_shifted(product, z2, 2 * half);
+	return product;
+}
+
+uint32_t BigInt::divide_small(Limbs& a, uint32_t divisor) {
+	uint64_t remainder = 0;
+	for (size_t i = a.size(); i-- > 0;) {
+		uint64_t cur = remainder << 32 | a[i];
+		a[i] = (uint32_t)(cur / divisor);
+		remainder = cur % divisor;
+	}
+	trim(a);
+	return (uint32_t)remainder;
+}
+
+void BigInt::divide(const Limbs& a, const Limbs& b, Limbs& quotient, Limbs& remainder) {
+	if (compare(a, b) < 0) {
+		quotient.clear();
+		remainder = a;
+		return;
+	}
+	if (b.size() == 1) {
+		quotient = a;
+		uint32_t rest = divide_small(quotient, b[0]);
+		remainder = rest ? Limbs{ rest } : Limbs{};
+		return;
+	}
+	// normalize so the divisor's top bit is set, which keeps each estimated
+	// quotient digit at most two too large
+	int shift = __builtin_clz(b.back());
+	size_t n = b.size();
+	size_t m = a.size() - n;
+	Limbs v(n);
+	for (size_t i = 0; i < n; ++i) {
+		v[i] = (uint32_t)((uint64_t)b[i] << shift | (uint64_t)(i ? b[i - 1] : 0) >> (32 - shift));
+	}
+	Limbs u(a.size() + 1);
+	for (size_t i = 0; i < a.size(); ++i) {
+		u[i] = (uint32_t)((uint64_t)a[i] << shift | (uint64_t)(i ? a[i - 1] : 0) >> (32 - shift));
+	}
+	u[a.size()] = (uint32_t)((uint64_t)a.back() >> (32 - shift));
+	const uint64_t base = (uint64_t)1 << 32;
+	quotient.assign(m + 1, 0);
+	for (size_t j = m + 1; j-- > 0;) {
+		uint64_t top = (uint64_t)u[j + n] << 32 | u[j + n - 1];
+		uint64_t qhat = top / v[n - 1];
+		uint64_t rhat = top % v[n - 1];
+		while (qhat >= base || qhat * v[n - 2] > (rhat << 32 | u[j + n - 2])) {
+			--qhat;
+			rhat += v[n - 1];
+			if (rhat >= base) { break; }
+		}
+		// u -= qhat * v, shifted by j
+		int64_t borrow = 0;
+		uint64_t carry = 0;
+		for (size_t i = 0; i < n; ++i) {
+			uint64_t p = qhat * v[i] + carry;
+			carry = p >> 32;
+			int64_t cur = (int64_t)u[i + j] - borrow - (int64_t)(uint32_t)p;
+			u[i + j] = (uint32_t)cur;
+			borrow = cur < 0;
+		}
+		int64_t cur = (int64_t)u[j + n] - borrow - (int64_t)carry;
+		u[j + n] = (uint32_t)cur;
+		if (cur < 0) {
+			// qhat was one too large: add v back
+			--qhat;
+			carry = 0;
+			for (size_t i = 0; i < n; ++i) {
+				uint64_t sum = (uint64_t)u[i + j] + v[i] + carry;
+				u[i + j] = (uint32_t)sum;
+				carry = sum >> 32;
+			}
+			u[j + n] += (uint32_t)carry;
+		}
+		quotient[j] = (uint32_t)qhat;
+	}
+	trim(quotient);
+	remainder.assign(n, 0);
+	for (size_t i = 0; i < n; ++i) {
+		remainder[i] = (uint32_t)(u[i] >> shift | (uint64_t)u[i + 1] << (32 - shift));
+	}
+	trim(remainder);
+}
+
+void BigInt::div_mod(const BigInt& a, const BigInt& b, BigInt& quotient, BigInt& remainder) {
+	if (b.is_zero()) {
+		throw std::runtime_error("Division by zero");
+	}
+	Limbs q, r;
+	divide(a.limbs, b.limbs, q, r);
+	quotient = BigInt(std::move(q), a.negative != b.negative);
+	remainder = BigInt(std::move(r), a.negative);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// arbitrary-precision integer, for int values that overflow a long long
+// (see VInt); arithmetic follows long long arithmetic without the overflow:
+// division truncates toward zero and a remainder has the dividend's sign
+class BigInt {
+public:
+	BigInt(long long value = 0);
+
+	// parses a decimal numeral with an optional '-'; false if str is not one
+	static bool parse(const std::string& str, BigInt& result);
+
+	bool fits_long_long() const;
+	// only meaningful if fits_long_long()
+	long long to_long_long() const;
+
+	std::string to_string() const;
+
+	bool is_zero() const { return limbs.empty(); }
+	bool is_negative() const { return negative; }
+
+	BigInt operator-() const;
+
+	friend BigInt operator+(const BigInt& a, const BigInt& b);
+	friend BigInt operator-(const BigInt& a, const BigInt& b);
+	friend BigInt operator*(const BigInt& a, const BigInt& b);
+	// throw std::runtime_error on a zero divisor
+	friend BigInt operator/(const BigInt& a, const BigInt& b);
+	friend BigInt operator%(const BigInt& a, const BigInt& b);
+
+	friend bool operator==(const BigInt& a, const BigInt& b);
+	friend bool operator<(const BigInt& a, const BigInt& b);
+
+private:
+	// magnitude in base 2^32, least significant limb first, without leading
+	// zero limbs (so zero has none)
+	using Limbs = std::vector<uint32_t>;
+
+	// operands with fewer limbs than this are multiplied by schoolbook
+	// multiplication, larger ones by Karatsuba's
+	static const size_t karatsubaThreshold = 32;
+
+	Limbs limbs;
+	// false for zero
+	bool negative = false;
+
+	BigInt(Limbs limbs, bool negative);
+
+	static void trim(Limbs& limbs);
+	static int compare(const Limbs& a, const Limbs& b);
+	static Limbs add(const Limbs& a, const Limbs& b);
+	// requires a >= b
+	static Limbs subtract(const Limbs& a, const Limbs& b);
+	// adds b * 2^(32 * shift) to a
+	static void add_shifted(Limbs& a, const Limbs& b, size_t shift);
+	static Limbs multiply(const Limbs& a, const Limbs& b);
+	static Limbs schoolbook(const Limbs& a, const Limbs& b);
+	static Limbs karatsuba(const Limbs& a, const Limbs& b);
+	// divides a in place, returning the remainder
+	static uint32_t divide_small(Limbs& a, uint32_t divisor);
+	// Knuth's algorithm D; requires a nonzero divisor
+	static void divide(const Limbs& a, const Limbs& b, Limbs& quotient, Limbs& remainder);
+	static void div_mod(const BigInt& a, const BigInt& b, BigInt& quotient, BigInt& remainder);
+};
@@ -10,34 +10,50 @@
 template <typename T>
 class Context {
 private:
-	using ContextImpl = std::unordered_map<std::string, std::vector<T>>;
+	struct Entry {
+		T value;
+		// is_open(value) when pushed
+		bool open;
+	};
+
+	using ContextImpl = std::unordered_map<std::string, std::vector<Entry>>;
 
 public:
+	// if set, entries for which it holds when pushed are counted by
+	// open_count() until popped (parallel type checking counts types with
+	// variables left to bind)
+	static inline bool (*is_open)(T value) = nullptr;
+
 	Context() {}
-	Context(const Context& other) : ctxImpl(other.ctxImpl) {}
+	// a context that sees parent's entries under its own; parent must not
+	// change while it is in use
+	explicit Context(const Context* parent) : parent(parent) {}
+	Context(const Context& other) : ctxImpl(other.ctxImpl), openCount(other.openCount), parent(other.parent) {}
 	Context& operator=(const Context& other) {
 		ctxImpl = other.ctxImpl;
+		openCount = other.openCount;
+		parent = other.parent;
 		return *this;
 	}
 
 	void print(std::ostream& os) const {
-		std::vector<std::pair<std::string, std::vector<T>>> list;
-		list.reserve(ctxImpl.size());
-		for (auto it = ctxImpl.begin(); it != ctxImpl.end(); ++it) {
-			if (it->second.size() > 0) {
-				list.push_back(*it);
+		std::vector<std::string> list;
+		for (const Context* ctx = this; ctx; ctx = ctx->parent) {
+			for (auto it = ctx->ctxImpl.begin(); it != ctx->ctxImpl.end(); ++it) {
+				if (it->second.size() > 0) {
+					list.push_back(it->first);
+				}
 			}
 		}
-		std::sort(list.begin(), list.end(), [](const std::pair<std::string, std::vector<T>>& a, const std::pair<std::string, std::vector<T>>& b) -> bool {
-			return a.first < b.first;
-		});
+		std::sort(list.begin(), list.end());
+		list.erase(std::unique(list.begin(), list.end()), list.end());
 		os << "[";
 		bool printComma = false;
-		for (auto pair : list) {
+		for (const std::string& ident : list) {
 			if (printComma) {
 				os << ", ";
 			}
-			os << pair.first;
+			os << ident;
 			printComma = true;
 		}
 		os << "]";
@@ -46,21 +62,32 @@ public:
 	T get(const std::string& ident) const {
 		auto it = ctxImpl.find(ident);
 		if (it == ctxImpl.end() || it->second.empty()) {
-			return nullptr;
+			return parent ? parent->get(ident) : nullptr;
 		}
-		return it->second.back();
+		return it->second.back().value;
 	}
 
 	void push(const std::string& ident, T value) {
-		ctxImpl[ident].push_back(value);
+		bool open = is_open && is_open(value);
+		ctxImpl[ident].push_back({ value, open });
+		openCount += open;
 	}
 
 	void pop(const std::string& ident) {
-		ctxImpl[ident].pop_back();
+		std::vector<Entry>& entries = ctxImpl[ident];
+		openCount -= entries.back().open;
+		entries.pop_back();
+	}
+
+	// open entries here and in the parents, shadowed or not
+	int open_count() const {
+		return openCount + (parent ? parent->open_count() : 0);
 	}
 
 private:
 	ContextImpl ctxImpl;
+	int openCount = 0;
+	const Context* parent = nullptr;
 };
 
 template <typename T>
@@ -1,4 +1,34 @@
 #include "Expr.h"
+#include "expr/EBoolLit.h"
+#include "expr/EFloatLit.h"
+#include "expr/EIntLit.h"
+#include "expr/EUnitLit.h"
+#include "value/VFun.h"
+
+__attribute__((noinline)) void* Expr::operator new(size_t size) {
+	HeapProfiler::record(size);
+	return ::operator new(size);
+}
+
+__attribute__((noinline)) void Expr::operator delete(void* p) {
+	::operator delete(p);
+}
+
+Expr* Expr::from_value(const Value* value, const Location& loc) {
+	if (const VInt* v = value->as<VInt>()) {
+		return new EIntLit(loc, nullptr, v->value, v->big);
+	} else if (const VFloat* v = value->as<VFloat>()) {
+		return new EFloatLit(loc, nullptr, v->value);
+	} else if (const VBool* v = value->as<VBool>()) {
+		return new EBoolLit(loc, nullptr, v->value);
+	} else if (value->as<VUnit>()) {
+		return new EUnitLit(loc, Type::Unit());
+	} else if (const VFun* v = value->as<VFun>()) {
+		// closures are closed expressions under substitution
+		return v->fun->copy();
+	}
+	throw std::runtime_error("Unable to convert value to expression");
+}
 
 std::ostream& operator<<(std::ostream& os, const Expr* expr) {
 	Expr::print(os, expr);
@@ -3,28 +3,48 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include <functional>
 #include <unordered_map>
+#include <unordered_set>
 #include "Type.h"
 #include "Token.h"
 #include "Value.h"
 #include "Source.h"
 #include "Context.h"
+#include "HeapProfiler.h"
 
 class Expr {
 public:
 	Location loc;
 	const Type* typeAnn = nullptr;
+	// type recorded by the type checker (nullptr until checked); each node is
+	// checked once, and copies keep the recorded type
+	mutable const Type* synType = nullptr;
 
 	// AST locations always have length 0 (AST nodes can be multi-line)
 	Expr(const Location& loc, const Type* typeAnn)
 		: loc({ loc.source, loc.line, loc.colStart, loc.colStart }), typeAnn(typeAnn) {}
 	virtual ~Expr() {}
+
+	// charges the node to the current site (--heap-profile)
+	// both are out of line: GCC only pairs them when neither is inlined, and
+	// reports -Wmismatched-new-delete in optimized builds otherwise
+	static void* operator new(size_t size);
+	static void operator delete(void* p);
+
 	virtual Expr* copy() const = 0;
 	virtual Expr* subst(const std::string& subIdent, const Expr* subExpr) const = 0;
 	virtual Value* eval() const = 0;
 	// bidirectional type synthesis & analysis
-	virtual const Type* type_syn(const Context<const Type*>& typeCtx, bool reportErrors = true) const = 0;
-	virtual bool type_ana(const Type* type, const Context<const Type*>& typeCtx) const = 0;
+	// binders push onto typeCtx and pop before returning, so checking is
+	// linear in program size (the context is never copied)
+	virtual const Type* type_syn(Context<const Type*>& typeCtx, bool reportErrors = true) const = 0;
+	virtual bool type_ana(const Type* type, Context<const Type*>& typeCtx) const = 0;
+	// adds the identifiers that occur free in this expression
+	virtual void free_vars(std::unordered_set<std::string>& vars) const = 0;
+	// calls fun on each direct subexpression (binder identifiers excluded);
+	// fun may replace the subexpression by assigning to it
+	virtual void for_each_child(const std::function<void(Expr*&)>& fun) = 0;
 
 	void report_error_at_expr(std::string error) const {
 		loc.source->report_error(loc.line, loc.colStart, 0, std::move(error));
@@ -42,11 +62,22 @@ public:
 		}
 	}
 
+	// converts a value back into an expression that evaluates to it
+	static Expr* from_value(const Value* value, const Location& loc);
+
 	template <typename T>
 	const T* as() const {
 		return dynamic_cast<const T*>(this);
 	}
 
+protected:
+	// records this node's checked type on a copy of it
+	template <typename T>
+	T* with_type(T* expr) const {
+		expr->synType = synType;
+		return expr;
+	}
+
 private:
 	virtual void print_impl(std::ostream& os) const = 0;
 };
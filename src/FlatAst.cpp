@@ -0,0 +1,206 @@
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include "FlatAst.h"
+#include "expr/EBinaryOp.h"
+#include "expr/EBoolLit.h"
+#include "expr/EFix.h"
+#include "expr/EFloatLit.h"
+#include "expr/EFun.h"
+#include "expr/EFunAp.h"
+#include "expr/EIf.h"
+#include "expr/EIntLit.h"
+#include "expr/ELet.h"
+#include "expr/ERecordLit.h"
+#include "expr/EUnaryOp.h"
+#include "expr/EUnitLit.h"
+#include "expr/EVar.h"
+
+namespace {
+
+template <typename K, typename V>
+uint32_t intern(std::unordered_map<K, uint32_t>& ids, std::vector<V>& values, const K& key, const V& value) {
+	auto it = ids.find(key);
+	if (it != ids.end()) { return it->second; }
+	values.push_back(value);
+	return ids[key] = values.size() - 1;
+}
+
+}
+
+FlatAst::FlatAst(Expr*& root) {
+	std::unordered_map<long long, uint32_t> intIds;
+	// floats are interned by bit pattern
+	std::unordered_map<uint64_t, uint32_t> floatIds;
+	std::unordered_map<std::string, uint32_t> nameIds;
+	auto name_id = [&](const std::string& name) {
+		return intern(nameIds, names, name, name);
+	};
+
+	// iterative postorder; numChildren is -1 until the node's children are pushed
+	struct Visit {
+		Expr** slot;
+		int numChildren;
+	};
+	std::vector<Visit> stack{ { &root, -1 } };
+	// indices of finished nodes whose parent is not finished yet
+	std::vector<uint32_t> pending;
+	while (!stack.empty()) {
+		Visit& visit = stack.back();
+		Expr* expr = *visit.slot;
+		if (visit.numChildren < 0) {
+			std::vector<Expr**> children;
+			expr->for_each_child([&children](Expr*& child) {
+				children.push_back(&child);
+			});
+			visit.numChildren = children.size();
+			for (auto it = children.rbegin(); it != children.rend(); ++it) {
+				stack.push_back({ *it, -1 });
+			}
+			continue;
+		}
+		Kind kind;
+		uint32_t payload = 0;
+		if (const EIntLit* e = expr->as<EIntLit>()) {
+			if (e->big) {
+				kind = Kind::BigIntLit;
+				payload = name_id(e->big->to_string());
+			} else {
+				kind = Kind::IntLit;
+				payload = intern(intIds, ints, e->value, e->value);
+			}
+		} else if (const EFloatLit* e = expr->as<EFloatLit>()) {
+			kind = Kind::FloatLit;
+			uint64_t bits;
+			memcpy(&bits, &e->value, sizeof(bits));
+			payload = intern(floatIds, floats, bits, e->value);
+		} else if (const EBoolLit* e = expr->as<EBoolLit>()) {
+			kind = Kind::BoolLit;
+			payload = e->value;
+		} else if (expr->as<EUnitLit>()) {
+			kind = Kind::UnitLit;
+		} else if (const EVar* e = expr->as<EVar>()) {
+			kind = Kind::Var;
+			payload = name_id(e->value);
+		} else if (const EFun* e = expr->as<EFun>()) {
+			kind = Kind::Fun;
+			payload = name_id(e->ident->value);
+		} else if (const EFix* e = expr->as<EFix>()) {
+			kind = Kind::Fix;
+			payload = name_id(e->ident->value);
+		} else if (expr->as<EFunAp>()) {
+			kind = Kind::FunAp;
+		} else if (expr->as<EIf>()) {
+			kind = Kind::If;
+		} else if (const ELet* e = expr->as<ELet>()) {
+			kind = Kind::Let;
+			payload = name_id(e->ident->value) << 1 | e->strict;
+		} else if (const EBinaryOp* e = expr->as<EBinaryOp>()) {
+			kind = Kind::BinaryOp;
+			payload = (uint32_t)e->op.type;
+		} else if (const EUnaryOp* e = expr->as<EUnaryOp>()) {
+			kind = Kind::UnaryOp;
+			payload = (uint32_t)e->op.type;
+		} else if (const ERecordLit* e = expr->as<ERecordLit>()) {
+			kind = Kind::RecordLit;
+			std::string fields;
+			for (const std::string& ident : e->idents) {
+				fields += (fields.empty() ? "" : ",") + ident;
+			}
+			payload = name_id(fields);
+		} else {
+			throw std::runtime_error("FlatAst: unknown expression");
+		}
+		uint32_t size = 1;
+		childStart.push_back(childIndices.size());
+		for (size_t i = pending.size() - visit.numChildren; i < pending.size(); ++i) {
+			childIndices.push_back(pending[i]);
+			size += sizes[pending[i]];
+		}
+		pending.resize(pending.size() - visit.numChildren);
+		pending.push_back(kinds.size());
+		kinds.push_back(kind);
+		payloads.push_back(payload);
+		sizes.push_back(size);
+		exprs.push_back(expr);
+		slots.push_back(visit.slot);
+		stack.pop_back();
+	}
+	childStart.push_back(childIndices.size());
+}
+
+std::vector<uint32_t> FlatAst::value_numbers() const {
+	std::vector<uint32_t> numbers(size());
+	// the first node numbered with each distinct expression, by hash
+	std::unordered_map<uint64_t, std::vector<uint32_t>> table;
+	uint32_t count = 0;
+	for (uint32_t node = 0; node < size(); ++node) {
+		uint64_t hash = (uint64_t)kinds[node] << 32 | payloads[node];
+		for (uint32_t i = childStart[node]; i < childStart[node + 1]; ++i) {
+			hash ^= numbers[childIndices[i]] + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+		}
+		std::vector<uint32_t>& candidates = table[hash];
+		auto same = [&](uint32_t other) {
+			if (kinds[other] != kinds[node] || payloads[other] != payloads[node]
+			    || num_children(other) != num_children(node)) {
+				return false;
+			}
+			for (uint32_t i = 0; i < num_children(node); ++i) {
+				if (numbers[child(other, i)] != numbers[child(node, i)]) { return false; }
+			}
+			return true;
+		};
+		auto it = std::find_if(candidates.begin(), candidates.end(), same);
+		if (it != candidates.end()) {
+			numbers[node] = numbers[*it];
+		} else {
+			candidates.push_back(node);
+			numbers[node] = count++;
+		}
+	}
+	return numbers;
+}
+
+std::vector<uint32_t> FlatAst::parents() const {
+	std::vector<uint32_t> result(size(), none);
+	for (uint32_t node = 0; node < size(); ++node) {
+		for (uint32_t i = childStart[node]; i < childStart[node + 1]; ++i) {
+			result[childIndices[i]] = node;
+		}
+	}
+	return result;
+}
+
+std::vector<uint32_t> FlatAst::binders() const {
+	std::vector<uint32_t> result(size(), none);
+	// innermost binder in scope for each name
+	std::vector<std::vector<uint32_t>> inScope(names.size());
+	// a node to visit, binding binderName to binder while its subtree is
+	// visited; a visit of node none unbinds binderName
+	struct Visit {
+		uint32_t node;
+		uint32_t binder;
+	};
+	std::vector<Visit> stack{ { root(), none } };
+	while (!stack.empty()) {
+		Visit visit = stack.back();
+		stack.pop_back();
+		if (visit.node == none) {
+			inScope[binder_name(visit.binder)].pop_back();
+			continue;
+		}
+		if (visit.binder != none) {
+			inScope[binder_name(visit.binder)].push_back(visit.binder);
+			stack.push_back({ none, visit.binder });
+		}
+		uint32_t node = visit.node;
+		if (kinds[node] == Kind::Var && !inScope[payloads[node]].empty()) {
+			result[node] = inScope[payloads[node]].back();
+		}
+		for (uint32_t i = num_children(node); i-- > 0;) {
+			uint32_t c = child(node, i);
+			stack.push_back({ c, is_binder(node) && scope(node) == c ? node : none });
+		}
+	}
+	return result;
+}
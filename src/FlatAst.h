@@ -0,0 +1,100 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Expr.h"
+
+// flat, struct-of-arrays form of an AST: node i's kind, payload and children
+// are entry i of parallel arrays, with children referenced by 32-bit index
+// nodes are numbered in postorder, so children precede their parents, the
+// root is the last node and the subtree of node i is the contiguous range
+// [first(i), i]; a bottom-up analysis is a single forward loop
+// the flat form is a read-only view: passes rewrite the pointer AST through
+// slots, then build a new FlatAst if they need one
+class FlatAst {
+public:
+	enum class Kind : uint8_t {
+		IntLit, BigIntLit, FloatLit, BoolLit, UnitLit, Var, Fun, Fix, FunAp, If, Let, BinaryOp, UnaryOp, RecordLit
+	};
+
+	// absent node index
+	static constexpr uint32_t none = 0xFFFFFFFF;
+
+	std::vector<Kind> kinds;
+	// what tells a node apart from others of its kind (type annotations are
+	// not recorded):
+	//   literal      index into ints or floats, or the bool value (a big int
+	//                literal is its decimal string's index into names)
+	//   var, binder  index into names (for a let, shifted left once and or'ed
+	//                with strictness)
+	//   operator     token type
+	//   record       index into names of the comma-joined field names
+	// equal payloads mean equal values, since every table is interned
+	std::vector<uint32_t> payloads;
+	// children of node i are childIndices[childStart[i]] up to (excluding)
+	// childIndices[childStart[i + 1]], in for_each_child order
+	std::vector<uint32_t> childStart;
+	std::vector<uint32_t> childIndices;
+	// number of nodes in the subtree of each node
+	std::vector<uint32_t> sizes;
+
+	std::vector<long long> ints;
+	std::vector<double> floats;
+	std::vector<std::string> names;
+
+	// the pointer AST's node for each flat node, and the child pointer that
+	// refers to it (the root's slot is the one given to the constructor)
+	std::vector<Expr*> exprs;
+	std::vector<Expr**> slots;
+
+	// flattens the AST at root without recursion
+	explicit FlatAst(Expr*& root);
+
+	uint32_t size() const {
+		return kinds.size();
+	}
+
+	uint32_t root() const {
+		return kinds.size() - 1;
+	}
+
+	// first node of the subtree of node (in postorder)
+	uint32_t first(uint32_t node) const {
+		return node + 1 - sizes[node];
+	}
+
+	uint32_t num_children(uint32_t node) const {
+		return childStart[node + 1] - childStart[node];
+	}
+
+	uint32_t child(uint32_t node, uint32_t i) const {
+		return childIndices[childStart[node] + i];
+	}
+
+	// number of each subtree's expression: equal numbers mean the same
+	// expression (up to type annotations); nodes are hash-consed on their
+	// kind, payload and children's numbers, so this takes one pass
+	std::vector<uint32_t> value_numbers() const;
+
+	// parent of each node, or none for the root
+	std::vector<uint32_t> parents() const;
+
+	// for each var node, the fun, fix or let node binding it, or none if it
+	// is free in the whole tree (a let binds its body, not its value)
+	std::vector<uint32_t> binders() const;
+
+	// the child of a binder node that its identifier is in scope in
+	uint32_t scope(uint32_t binder) const {
+		return kinds[binder] == Kind::Let ? child(binder, 1) : child(binder, 0);
+	}
+
+	bool is_binder(uint32_t node) const {
+		return kinds[node] == Kind::Fun || kinds[node] == Kind::Fix || kinds[node] == Kind::Let;
+	}
+
+	// index into names of the identifier bound by a binder node
+	uint32_t binder_name(uint32_t binder) const {
+		return kinds[binder] == Kind::Let ? payloads[binder] >> 1 : payloads[binder];
+	}
+};
@@ -0,0 +1,70 @@
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include "HeapProfiler.h"
+#include "Expr.h"
+
+bool HeapProfiler::enabled = false;
+uint64_t HeapProfiler::snapshotBytes = 64 << 20;
+std::ostream* HeapProfiler::log = &std::cerr;
+thread_local std::pair<const Expr*, const char*> HeapProfiler::current{ nullptr, "program" };
+std::mutex HeapProfiler::mutex;
+std::map<HeapProfiler::Site, HeapProfiler::Usage> HeapProfiler::sites;
+uint64_t HeapProfiler::totalBytes = 0;
+uint64_t HeapProfiler::nextSnapshot = 0;
+
+void HeapProfiler::reset(std::ostream& log) {
+	std::lock_guard<std::mutex> lock(mutex);
+	HeapProfiler::log = &log;
+	sites.clear();
+	totalBytes = 0;
+	nextSnapshot = 0;
+}
+
+void HeapProfiler::record_at_current(size_t size) {
+	const Expr* expr = current.first;
+	long long location = expr ? (long long)expr->loc.line << 32 | (unsigned)expr->loc.colStart : -1;
+	std::lock_guard<std::mutex> lock(mutex);
+	Usage& usage = sites[{ location, current.second }];
+	usage.bytes += size;
+	++usage.objects;
+	totalBytes += size;
+	if (snapshotBytes > 0 && totalBytes >= nextSnapshot + snapshotBytes) {
+		nextSnapshot = totalBytes - totalBytes % snapshotBytes;
+		*log << "heap profile snapshot:" << std::endl;
+		print_sites(*log, 10);
+	}
+}
+
+void HeapProfiler::print_report(std::ostream& os, int n) {
+	std::lock_guard<std::mutex> lock(mutex);
+	print_sites(os, n);
+}
+
+void HeapProfiler::print_sites(std::ostream& os, int n) {
+	std::vector<std::pair<Site, Usage>> sorted(sites.begin(), sites.end());
+	uint64_t bytes = 0;
+	uint64_t objects = 0;
+	for (const auto& [site, usage] : sorted) {
+		bytes += usage.bytes;
+		objects += usage.objects;
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+		return a.second.bytes > b.second.bytes;
+	});
+	char line[256];
+	snprintf(line, sizeof(line), "heap: %llu bytes in %llu objects at %zu sites\n%14s %7s %12s  %s\n",
+	         (unsigned long long)bytes, (unsigned long long)objects, sorted.size(), "bytes", "%", "objects", "site");
+	os << line;
+	for (int i = 0; i < n && i < (int)sorted.size(); ++i) {
+		const auto& [site, usage] = sorted[i];
+		std::string where = site.first < 0
+		                    ? std::string(site.second)
+		                    : std::string(site.second) + "@" + std::to_string((site.first >> 32) + 1) + ":" + std::to_string(site.first & 0xffffffff);
+		snprintf(line, sizeof(line), "%14llu %6.1f%% %12llu  %s\n",
+		         (unsigned long long)usage.bytes, bytes ? 100.0 * usage.bytes / bytes : 0.0,
+		         (unsigned long long)usage.objects, where.c_str());
+		os << line;
+	}
+	os << std::flush;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <iostream>
+
+class Expr;
+
+// allocation-site heap profiler (--heap-profile)
+// every Expr node and Value allocated during evaluation is charged to the
+// innermost expression being evaluated that allocates (an application, fix,
+// let or operator); nothing is ever freed, so the totals are live memory
+// the profile is process-wide: each run resets it, and runs must not overlap
+// (batch and serve modes only allow --heap-profile with -j 1)
+class HeapProfiler {
+public:
+	// set once, before any run
+	static bool enabled;
+	// a snapshot of the top sites is printed to the run's log each time this
+	// many more bytes have been allocated
+	static uint64_t snapshotBytes;
+
+	// charges allocations made while it is alive to expr
+	class Scope {
+	public:
+		Scope(const Expr* expr, const char* kind) : active(enabled) {
+			if (active) {
+				previous = current;
+				current = { expr, kind };
+			}
+		}
+		~Scope() {
+			if (active) { current = previous; }
+		}
+
+	private:
+		bool active;
+		std::pair<const Expr*, const char*> previous{ nullptr, nullptr };
+	};
+
+	// discards the allocations of earlier runs (and of this run so far);
+	// snapshots go to log until the next reset
+	static void reset(std::ostream& log);
+
+	static void record(size_t size) {
+		if (enabled) { record_at_current(size); }
+	}
+
+	// sites sorted by bytes; at most n of them
+	static void print_report(std::ostream& os, int n);
+
+private:
+	struct Usage {
+		uint64_t bytes = 0;
+		uint64_t objects = 0;
+	};
+
+	// (line, column) of the site and its kind
+	using Site = std::pair<long long, const char*>;
+
+	static thread_local std::pair<const Expr*, const char*> current;
+	static std::mutex mutex;
+	static std::ostream* log;
+	static std::map<Site, Usage> sites;
+	static uint64_t totalBytes;
+	static uint64_t nextSnapshot;
+
+	static void record_at_current(size_t size);
+	// the caller holds mutex
+	static void print_sites(std::ostream& os, int n);
+};
@@ -1,4 +1,11 @@
+#include <memory>
+#include <iterator>
+#include <functional>
 #include "Lexer.h"
+#include "Runtime.h"
+#include "ThreadPool.h"
+
+size_t Lexer::parallelThreshold = 1 << 20;
 
 std::deque<Token> Lexer::get_tokens() {
 	if (lexed) {
@@ -6,10 +13,19 @@ std::deque<Token> Lexer::get_tokens() {
 	}
 	lexed = true;
 
+	size_t size = 0;
+	for (const std::string& line : source.lines) {
+		size += line.size() + 1;
+	}
+
 	// generate token deque
 	std::deque<Token> tokens;
-	while (buf_valid()) {
-		tokens.push_back(next());
+	if (Runtime::pool && size >= parallelThreshold) {
+		tokens = get_tokens_parallel();
+	} else {
+		while (buf_valid()) {
+			tokens.push_back(next());
+		}
 	}
 
 	// push back eof
@@ -19,9 +35,92 @@ std::deque<Token> Lexer::get_tokens() {
 
 	// report errors for unterm comments
 	for (const Location& loc : commentStack) {
-		source.report_error(loc.line, loc.colStart, loc.colEnd - loc.colStart, "unterminated comment");
+		report_error(loc.line, loc.colStart, loc.colEnd - loc.colStart, "unterminated comment");
 	}
 
+	for (Error& error : errors) {
+		source.report_error(error.line, error.col, error.len, std::move(error.error));
+	}
+	return tokens;
+}
+
+void Lexer::lex(std::vector<Token>& tokens) {
+	while (buf_valid()) {
+		tokens.push_back(next());
+	}
+}
+
+void Lexer::scan_comments() {
+	for (int line = this->line; line < endLine; ++line) {
+		const std::string& text = source.lines[line];
+		for (int col = 0; col + 1 < (int)text.size(); ++col) {
+			if (text[col] == '(' && text[col + 1] == '*') {
+				commentStack.push_back({ &source, line, col, col + 2 });
+				++col;
+			} else if (text[col] == '*' && text[col + 1] == ')') {
+				if (commentStack.empty()) {
+					++unmatchedCloses;
+				} else {
+					commentStack.pop_back();
+				}
+				++col;
+			}
+		}
+	}
+}
+
+// tokens never span lines, so the only state carried from one line to the
+// next is the stack of open comments; it is found for each chunk's first
+// line from a scan of the comment delimiters, and then every chunk is lexed
+// once, starting in the right state
+// delimiters are found at the same places inside and outside comments (no
+// token contains '(', '*' or ')'), so the scan needs no state: whatever the
+// comments open before a chunk, its unmatched '*)'s close the innermost of
+// them, and the comments it opens are still open after it
+std::deque<Token> Lexer::get_tokens_parallel() {
+	ThreadPool* pool = Runtime::pool;
+	int numChunks = std::min(pool->size() * 4, endLine);
+	std::vector<std::unique_ptr<Lexer>> chunks;
+	std::vector<std::vector<Token>> chunkTokens(numChunks);
+	for (int i = 0; i < numChunks; ++i) {
+		chunks.emplace_back(new Lexer(source));
+		chunks[i]->line = (long long)endLine * i / numChunks;
+		chunks[i]->endLine = (long long)endLine * (i + 1) / numChunks;
+	}
+	auto run_chunks = [&](const std::function<void(int)>& job) {
+		std::vector<std::unique_ptr<ThreadPool::Task>> tasks;
+		for (int i = 0; i < numChunks; ++i) {
+			tasks.emplace_back(new ThreadPool::Task([&job, i]() {
+				job(i);
+			}));
+			pool->spawn(tasks.back().get());
+		}
+		for (auto& task : tasks) {
+			pool->wait(task.get());
+		}
+	};
+
+	run_chunks([&](int i) {
+		chunks[i]->scan_comments();
+	});
+	std::vector<Location> open;
+	for (int i = 0; i < numChunks; ++i) {
+		Lexer& chunk = *chunks[i];
+		std::vector<Location> opened = std::move(chunk.commentStack);
+		chunk.commentStack = open;
+		open.resize(open.size() - std::min<size_t>(chunk.unmatchedCloses, open.size()));
+		open.insert(open.end(), opened.begin(), opened.end());
+	}
+	run_chunks([&](int i) {
+		chunks[i]->lex(chunkTokens[i]);
+	});
+
+	std::deque<Token> tokens;
+	for (int i = 0; i < numChunks; ++i) {
+		std::move(chunkTokens[i].begin(), chunkTokens[i].end(), std::back_inserter(tokens));
+		std::move(chunks[i]->errors.begin(), chunks[i]->errors.end(), std::back_inserter(errors));
+	}
+	commentStack = std::move(chunks.back()->commentStack);
 	return tokens;
 }
 
@@ -129,12 +228,12 @@ Token Lexer::next() {
 	// unrecognized char
 	++col;
 	std::string unrecognizedChar = get_line().substr(colStart, 1);
-	source.report_error(line, colStart, col - colStart, "stray '" + unrecognizedChar + "' in program");
+	report_error(line, colStart, col - colStart, "stray '" + unrecognizedChar + "' in program");
 	return { {&source, line, colStart, col}, TokenType::Error, unrecognizedChar };
 }
 
 bool Lexer::buf_valid() {
-	while (line < source.lines.size()) {
+	while (line < endLine) {
 		if (col >= get_line().size()) {
 			++line;
 			col = 0;
@@ -150,7 +249,8 @@ bool Lexer::buf_valid() {
 		}
 		if (try_consume("*)")) {
 			if (commentStack.empty()) {
-				source.report_error(line, col-2, 2, "expected comment before '*)' token");
+				report_error(line, col-2, 2, "expected comment before '*)' token");
+				++unmatchedCloses;
 				continue;
 			} else {
 				commentStack.pop_back();
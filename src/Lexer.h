@@ -10,16 +10,46 @@
 
 class Lexer {
 public:
-	Lexer(const Source& source) : source(source) {}
+	// sources of at least this many bytes are lexed in chunks of lines on
+	// Runtime::pool (--parallel=N), if there is one
+	static size_t parallelThreshold;
+
+	Lexer(const Source& source) : source(source), endLine((int)source.lines.size()) {}
 
 	std::deque<Token> get_tokens();
 
 private:
+	struct Error {
+		int line;
+		int col;
+		int len;
+		std::string error;
+	};
+
 	const Source& source;
 	bool lexed = false; // flag indicating whether lexing already occurred
 	int line = 0;
 	int col = 0;
+	int endLine; // lexing stops before this line
 	std::vector<Location> commentStack; // open comment locations
+	int unmatchedCloses = 0; // '*)' with no open comment
+	// reported to source when lexing is done (chunks lexed in parallel
+	// report theirs in order)
+	std::vector<Error> errors;
+
+	// lexes the lines before endLine
+	void lex(std::vector<Token>& tokens);
+
+	// leaves the comments opened and not closed by the lines before endLine
+	// on commentStack and counts the other '*)'s in unmatchedCloses,
+	// without lexing
+	void scan_comments();
+
+	std::deque<Token> get_tokens_parallel();
+
+	void report_error(int line, int col, int len, std::string error) {
+		errors.push_back({ line, col, len, std::move(error) });
+	}
 
 	Token next();
 
@@ -0,0 +1,87 @@
+#include <cstring>
+#include "MemoTable.h"
+#include "value/VInt.h"
+#include "value/VBool.h"
+#include "value/VUnit.h"
+#include "value/VFloat.h"
+
+size_t MemoTable::maxEntries = 1 << 20;
+std::atomic<long long> MemoTable::hits{ 0 };
+std::atomic<long long> MemoTable::misses{ 0 };
+std::atomic<long long> MemoTable::entries{ 0 };
+
+bool MemoTable::lookup(const Value* arg, Value*& result) {
+	Key key;
+	if (!make_key(arg, key)) { return false; }
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!slots.empty()) {
+		const Slot& slot = slots[probe(key)];
+		if (slot.key == key) {
+			++hits;
+			result = slot.result;
+			return true;
+		}
+	}
+	++misses;
+	return false;
+}
+
+void MemoTable::insert(const Value* arg, Value* result) {
+	Key key;
+	if (!make_key(arg, key)) { return; }
+	std::lock_guard<std::mutex> lock(mutex);
+	if (count >= maxEntries) { return; }
+	if (2 * (count + 1) > slots.size()) {
+		grow();
+	}
+	Slot& slot = slots[probe(key)];
+	if (slot.key == key) { return; } // inserted by another thread meanwhile
+	slot.key = key;
+	slot.result = result;
+	++count;
+	++entries;
+}
+
+bool MemoTable::make_key(const Value* arg, Key& key) {
+	if (const VInt* v = arg->as<VInt>()) {
+		// big ints do not fit in a key, and are not memoized
+		if (v->big) { return false; }
+		key.tag = 1;
+		key.bits = (unsigned long long)v->value;
+	} else if (const VFloat* v = arg->as<VFloat>()) {
+		key.tag = 2;
+		std::memcpy(&key.bits, &v->value, sizeof(key.bits));
+	} else if (const VBool* v = arg->as<VBool>()) {
+		key.tag = 3;
+		key.bits = v->value;
+	} else if (arg->as<VUnit>()) {
+		key.tag = 4;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+size_t MemoTable::probe(const Key& key) const {
+	// splitmix64 finalizer
+	unsigned long long h = key.bits + key.tag * 0x9e3779b97f4a7c15ULL;
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+	h ^= h >> 31;
+	size_t mask = slots.size() - 1;
+	size_t i = h & mask;
+	while (slots[i].key.tag != 0 && !(slots[i].key == key)) {
+		i = (i + 1) & mask;
+	}
+	return i;
+}
+
+void MemoTable::grow() {
+	std::vector<Slot> old = std::move(slots);
+	slots = std::vector<Slot>(old.empty() ? 16 : old.size() * 2);
+	for (const Slot& slot : old) {
+		if (slot.key.tag != 0) {
+			slots[probe(slot.key)] = slot;
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include "Value.h"
+
+// cache of results for one recursive (fix) function, keyed by argument value
+// only int, float, bool and unit arguments are hashable; other arguments
+// bypass the table
+// open addressing with linear probing, kept at most half full
+class MemoTable {
+public:
+	// entries allowed per table; once full, new results are not cached
+	static size_t maxEntries;
+
+	// process-wide counters (summed over all tables)
+	static std::atomic<long long> hits;
+	static std::atomic<long long> misses;
+	static std::atomic<long long> entries;
+
+	// returns true and sets result if a result is cached for arg
+	bool lookup(const Value* arg, Value*& result);
+
+	void insert(const Value* arg, Value* result);
+
+private:
+	struct Key {
+		unsigned char tag = 0; // 0 marks an empty slot
+		unsigned long long bits = 0;
+		bool operator==(const Key& other) const {
+			return tag == other.tag && bits == other.bits;
+		}
+	};
+
+	struct Slot {
+		Key key;
+		Value* result = nullptr;
+	};
+
+	std::vector<Slot> slots;
+	size_t count = 0;
+	std::mutex mutex; // tables are shared by parallel evaluation
+
+	// returns false if arg is not hashable
+	static bool make_key(const Value* arg, Key& key);
+
+	// index of the slot holding key, or of the empty slot where it belongs
+	size_t probe(const Key& key) const;
+
+	void grow();
+};
@@ -5,7 +5,7 @@ const std::unordered_map<UnaryOpSignature, UnaryOpResult> OpDefinition::unaryOpD
 		{ TokenType::Minus, Type::Int() },
 		{
 			Type::Int(), [](const Value* v) -> Value* {
-				return new VInt(-v->as<VInt>()->value);
+				return VInt::negate(v->as<VInt>());
 			}
 		}
 	},
@@ -33,7 +33,7 @@ const std::unordered_map<BinaryOpSignature, BinaryOpResult> OpDefinition::binary
 		{ Type::Int(), TokenType::Equals, Type::Int() },
 		{
 			Type::Bool(), [](const Value* l, const Value* r) -> Value* {
-				return new VBool(l->as<VInt>()->value == r->as<VInt>()->value);
+				return new VBool(VInt::equals(l->as<VInt>(), r->as<VInt>()));
 			}
 		}
 	},
@@ -65,7 +65,7 @@ const std::unordered_map<BinaryOpSignature, BinaryOpResult> OpDefinition::binary
 		{ Type::Int(), TokenType::Lt, Type::Int() },
 		{
 			Type::Bool(), [](const Value* l, const Value* r) -> Value* {
-				return new VBool(l->as<VInt>()->value < r->as<VInt>()->value);
+				return new VBool(VInt::less(l->as<VInt>(), r->as<VInt>()));
 			}
 		}
 	},
@@ -97,7 +97,7 @@ const std::unordered_map<BinaryOpSignature, BinaryOpResult> OpDefinition::binary
 		{ Type::Int(), TokenType::Plus, Type::Int() },
 		{
 			Type::Int(), [](const Value* l, const Value* r) -> Value* {
-				return new VInt(l->as<VInt>()->value + r->as<VInt>()->value);
+				return VInt::add(l->as<VInt>(), r->as<VInt>());
 			}
 		}
 	},
@@ -113,7 +113,7 @@ const std::unordered_map<BinaryOpSignature, BinaryOpResult> OpDefinition::binary
 		{ Type::Int(), TokenType::Minus, Type::Int() },
 		{
 			Type::Int(), [](const Value* l, const Value* r) -> Value* {
-				return new VInt(l->as<VInt>()->value - r->as<VInt>()->value);
+				return VInt::subtract(l->as<VInt>(), r->as<VInt>());
 			}
 		}
 	},
@@ -129,7 +129,7 @@ const std::unordered_map<BinaryOpSignature, BinaryOpResult> OpDefinition::binary
 		{ Type::Int(), TokenType::Mul, Type::Int() },
 		{
 			Type::Int(), [](const Value* l, const Value* r) -> Value* {
-				return new VInt(l->as<VInt>()->value * r->as<VInt>()->value);
+				return VInt::multiply(l->as<VInt>(), r->as<VInt>());
 			}
 		}
 	},
@@ -145,7 +145,7 @@ const std::unordered_map<BinaryOpSignature, BinaryOpResult> OpDefinition::binary
 		{ Type::Int(), TokenType::Div, Type::Int() },
 		{
 			Type::Int(), [](const Value* l, const Value* r) -> Value* {
-				return new VInt(l->as<VInt>()->value / r->as<VInt>()->value);
+				return VInt::divide(l->as<VInt>(), r->as<VInt>());
 			}
 		}
 	},
@@ -161,7 +161,7 @@ const std::unordered_map<BinaryOpSignature, BinaryOpResult> OpDefinition::binary
 		{ Type::Int(), TokenType::Mod, Type::Int() },
 		{
 			Type::Int(), [](const Value* l, const Value* r) -> Value* {
-				return new VInt(l->as<VInt>()->value % r->as<VInt>()->value);
+				return VInt::modulo(l->as<VInt>(), r->as<VInt>());
 			}
 		}
 	}
@@ -2,6 +2,7 @@
 
 #include <sstream>
 #include <utility>
+#include <functional>
 #include <unordered_map>
 #include "Type.h"
 #include "Token.h"
@@ -61,7 +62,32 @@ struct BinaryOpResult {
 
 class OpDefinition {
 public:
+	// type of an operation on operands whose type is still a variable: the
+	// variable is restricted to the builtin types that define op (int first,
+	// which is what it defaults to), and the result is the variable itself
+	// where op returns its operand type; nullptr if no type is left
+	static const Type* open_unary_op_type(TokenType op, const TVar* rtype) {
+		std::vector<const Type*> types;
+		for (const Type* type : { Type::Int(), Type::Float(), Type::Bool(), Type::Unit() }) {
+			if (unary_op_type(op, type)) { types.push_back(type); }
+		}
+		if (!Type::restrict(rtype, types)) { return nullptr; }
+		const Type* result = unary_op_type(op, rtype->operandTypes.front());
+		return result == rtype->operandTypes.front() ? rtype : result;
+	}
+
+	static const Type* open_binary_op_type(const TVar* ltype, TokenType op) {
+		std::vector<const Type*> types;
+		for (const Type* type : { Type::Int(), Type::Float(), Type::Bool(), Type::Unit() }) {
+			if (binary_op_type(type, op, type)) { types.push_back(type); }
+		}
+		if (!Type::restrict(ltype, types)) { return nullptr; }
+		const Type* result = binary_op_type(ltype->operandTypes.front(), op, ltype->operandTypes.front());
+		return result == ltype->operandTypes.front() ? ltype : result;
+	}
+
 	static const Type* unary_op_type(TokenType op, const Type* rtype) {
+		Stats::count(Stats::opLookups);
 		if (!rtype) { return nullptr; }
 		auto it = unaryOpDefs.find({ op, rtype });
 		if (it == unaryOpDefs.end()) { return nullptr; }
@@ -69,6 +95,7 @@ public:
 	}
 
 	static const Type* binary_op_type(const Type* ltype, TokenType op, const Type* rtype) {
+		Stats::count(Stats::opLookups);
 		if (!ltype || !rtype) { return nullptr; }
 		switch (op) {
 		// hard-coding derivative operators (see binary_op_result for eval)
@@ -105,6 +132,7 @@ public:
 	}
 
 	static Value* unary_op_result(TokenType op, const Value* right) {
+		Stats::count(Stats::opLookups);
 		const Type* rtype = right->get_type();
 		if (!rtype) {
 			throw std::runtime_error("UnaryOpResult: Failed to get right type");
@@ -115,6 +143,7 @@ public:
 	}
 
 	static Value* binary_op_result(const Value* left, TokenType op, const Value* right) {
+		Stats::count(Stats::opLookups);
 		const Type* ltype = left->get_type();
 		if (!ltype) {
 			throw std::runtime_error("BinaryOpResult: Failed to get left type");
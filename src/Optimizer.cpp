@@ -0,0 +1,479 @@
+#include <atomic>
+#include "Optimizer.h"
+#include "FlatAst.h"
+#include "Runtime.h"
+#include "OpDefinition.h"
+#include "expr/EBinaryOp.h"
+#include "expr/EBoolLit.h"
+#include "expr/EFix.h"
+#include "expr/EFun.h"
+#include "expr/EFunAp.h"
+#include "expr/EFloatLit.h"
+#include "expr/EIf.h"
+#include "expr/EIntLit.h"
+#include "expr/ELet.h"
+#include "expr/ERecordLit.h"
+#include "expr/EUnaryOp.h"
+#include "expr/EUnitLit.h"
+#include "expr/EVar.h"
+
+static bool is_literal(const Expr* expr) {
+	return expr->as<EIntLit>() || expr->as<EFloatLit>() || expr->as<EBoolLit>() || expr->as<EUnitLit>();
+}
+
+static bool is_int(const Expr* expr, long long value) {
+	const EIntLit* lit = expr->as<EIntLit>();
+	return lit && !lit->big && lit->value == value;
+}
+
+static bool is_float(const Expr* expr, double value) {
+	const EFloatLit* lit = expr->as<EFloatLit>();
+	return lit && lit->value == value;
+}
+
+static bool is_bool(const Expr* expr, bool value) {
+	const EBoolLit* lit = expr->as<EBoolLit>();
+	return lit && lit->value == value;
+}
+
+// true if evaluating the operation would trap (integer division by zero);
+// such operations are left for evaluation to report
+static bool traps(const EBinaryOp* expr) {
+	if (expr->op.type != TokenType::Div && expr->op.type != TokenType::Mod) { return false; }
+	return is_int(expr->right, 0);
+}
+
+// algebraic identities that drop an operand without dropping any work
+static Expr* simplify(EBinaryOp* expr) {
+	Expr* left = expr->left;
+	Expr* right = expr->right;
+	switch (expr->op.type) {
+	case TokenType::Plus:
+		if (is_int(right, 0)) { return left; }
+		if (is_int(left, 0)) { return right; }
+		break;
+	case TokenType::Minus:
+		if (is_int(right, 0)) { return left; }
+		break;
+	case TokenType::Mul:
+		if (is_int(right, 1) || is_float(right, 1.0)) { return left; }
+		if (is_int(left, 1) || is_float(left, 1.0)) { return right; }
+		break;
+	case TokenType::Div:
+		if (is_int(right, 1) || is_float(right, 1.0)) { return left; }
+		break;
+	case TokenType::And:
+		if (is_bool(right, true)) { return left; }
+		if (is_bool(left, true)) { return right; }
+		break;
+	case TokenType::Or:
+		if (is_bool(right, false)) { return left; }
+		if (is_bool(left, false)) { return right; }
+		break;
+	default:
+		break;
+	}
+	return expr;
+}
+
+// a function that may be inlined, with the binders its free variables
+// referred to where it was defined
+struct KnownFun {
+	const EFun* fun;
+	std::vector<std::pair<std::string, const EVar*>> freeVars;
+};
+
+struct InlineScope {
+	Context<const KnownFun*> funs; // nullptr for bindings that are not known funs
+	Context<const EVar*> binders;
+	int budget = Optimizer::inlineBudget;
+
+	void push(const EVar* ident, const KnownFun* fun) {
+		funs.push(ident->value, fun);
+		binders.push(ident->value, ident);
+	}
+
+	void pop(const EVar* ident) {
+		funs.pop(ident->value);
+		binders.pop(ident->value);
+	}
+};
+
+// adds the identifiers bound anywhere inside expr
+static void bound_vars(Expr* expr, std::unordered_set<std::string>& vars) {
+	if (const EFun* e = expr->as<EFun>()) {
+		vars.insert(e->ident->value);
+	} else if (const EFix* e = expr->as<EFix>()) {
+		vars.insert(e->ident->value);
+	} else if (const ELet* e = expr->as<ELet>()) {
+		vars.insert(e->ident->value);
+	}
+	expr->for_each_child([&vars](Expr*& child) {
+		bound_vars(child, vars);
+	});
+}
+
+static const KnownFun* known_fun(Expr* value, InlineScope& scope) {
+	if (const EVar* var = value->as<EVar>()) {
+		return scope.funs.get(var->value); // alias
+	}
+	EFun* fun = dynamic_cast<EFun*>(value);
+	if (!fun || Optimizer::size(fun->body) > Optimizer::maxInlineSize) { return nullptr; }
+	KnownFun* known = new KnownFun{ fun, {} };
+	std::unordered_set<std::string> vars;
+	fun->free_vars(vars);
+	for (const std::string& var : vars) {
+		known->freeVars.push_back({ var, scope.binders.get(var) });
+	}
+	return known;
+}
+
+static Expr* inline_expr(Expr* expr, InlineScope& scope);
+
+// returns the beta-reduced application, or nullptr if it cannot be inlined
+static Expr* beta_reduce(EFunAp* ap, InlineScope& scope) {
+	const EFun* fun = ap->fun->as<EFun>();
+	if (!fun) {
+		const EVar* var = ap->fun->as<EVar>();
+		if (!var) { return nullptr; }
+		const KnownFun* known = scope.funs.get(var->value);
+		if (!known) { return nullptr; }
+		// the body must not see different bindings than at its definition
+		for (auto& freeVar : known->freeVars) {
+			if (scope.binders.get(freeVar.first) != freeVar.second) { return nullptr; }
+		}
+		fun = known->fun;
+	}
+	int bodySize = Optimizer::size(fun->body);
+	if (bodySize > Optimizer::maxInlineSize || bodySize > scope.budget) { return nullptr; }
+	// an application evaluates its argument even if the body never uses it,
+	// so only values are substituted; any other argument is bound by a strict
+	// let, which evaluates it first just the same (and only once)
+	if (!is_literal(ap->arg) && !ap->arg->as<EVar>() && !ap->arg->as<EFun>()) {
+		scope.budget -= bodySize;
+		return new ELet(ap->loc, nullptr, fun->ident, ap->arg, fun->body->copy(), true);
+	}
+	// subst is not capture-avoiding, so the argument's free variables must
+	// not be rebound inside the body
+	std::unordered_set<std::string> argVars;
+	ap->arg->free_vars(argVars);
+	std::unordered_set<std::string> bodyBinders;
+	bound_vars(fun->body, bodyBinders);
+	for (const std::string& var : argVars) {
+		if (bodyBinders.count(var)) { return nullptr; }
+	}
+	scope.budget -= bodySize;
+	return fun->body->subst(fun->ident->value, ap->arg);
+}
+
+static Expr* inline_expr(Expr* expr, InlineScope& scope) {
+	if (ELet* e = dynamic_cast<ELet*>(expr)) {
+		e->value = inline_expr(e->value, scope);
+		scope.push(e->ident, known_fun(e->value, scope));
+		e->body = inline_expr(e->body, scope);
+		scope.pop(e->ident);
+		return e;
+	} else if (EFun* e = dynamic_cast<EFun*>(expr)) {
+		scope.push(e->ident, nullptr);
+		e->body = inline_expr(e->body, scope);
+		scope.pop(e->ident);
+		return e;
+	} else if (EFix* e = dynamic_cast<EFix*>(expr)) {
+		scope.push(e->ident, nullptr);
+		e->body = inline_expr(e->body, scope);
+		scope.pop(e->ident);
+		return e;
+	} else if (EFunAp* e = dynamic_cast<EFunAp*>(expr)) {
+		e->fun = inline_expr(e->fun, scope);
+		e->arg = inline_expr(e->arg, scope);
+		Expr* reduced = beta_reduce(e, scope);
+		if (reduced) {
+			// the argument may itself be a function applied in the body
+			return inline_expr(reduced, scope);
+		}
+		return e;
+	}
+	expr->for_each_child([&scope](Expr*& child) {
+		child = inline_expr(child, scope);
+	});
+	return expr;
+}
+
+// nodes of a FlatAst that have been cut out of the pointer AST; ranges are
+// marked with a jump to the next live node, so every node is marked once
+struct DeadNodes {
+	std::vector<uint32_t> next;
+
+	explicit DeadNodes(uint32_t size) : next(size + 1) {
+		for (uint32_t i = 0; i <= size; ++i) { next[i] = i; }
+	}
+
+	uint32_t next_live(uint32_t node) {
+		while (next[node] != node) {
+			next[node] = next[next[node]];
+			node = next[node];
+		}
+		return node;
+	}
+
+	bool dead(uint32_t node) {
+		return next_live(node) != node;
+	}
+
+	void kill(uint32_t first, uint32_t last) {
+		for (uint32_t node = next_live(first); node <= last; node = next_live(node)) {
+			next[node] = node + 1;
+		}
+	}
+};
+
+static Expr* eliminate_dead(Expr* expr, std::unordered_set<std::string>& vars) {
+	if (ELet* e = dynamic_cast<ELet*>(expr)) {
+		std::unordered_set<std::string> bodyVars;
+		e->body = eliminate_dead(e->body, bodyVars);
+		if (!e->strict && !bodyVars.count(e->ident->value)) {
+			vars.insert(bodyVars.begin(), bodyVars.end());
+			return e->body;
+		}
+		bodyVars.erase(e->ident->value);
+		vars.insert(bodyVars.begin(), bodyVars.end());
+		e->value = eliminate_dead(e->value, vars);
+		return e;
+	} else if (EFun* e = dynamic_cast<EFun*>(expr)) {
+		std::unordered_set<std::string> bodyVars;
+		e->body = eliminate_dead(e->body, bodyVars);
+		bodyVars.erase(e->ident->value);
+		vars.insert(bodyVars.begin(), bodyVars.end());
+		return e;
+	} else if (EFix* e = dynamic_cast<EFix*>(expr)) {
+		std::unordered_set<std::string> bodyVars;
+		e->body = eliminate_dead(e->body, bodyVars);
+		bool recursive = bodyVars.count(e->ident->value);
+		bodyVars.erase(e->ident->value);
+		vars.insert(bodyVars.begin(), bodyVars.end());
+		if (!recursive) {
+			return e->body;
+		}
+		return e;
+	} else if (EIf* e = dynamic_cast<EIf*>(expr)) {
+		if (const EBoolLit* test = e->test->as<EBoolLit>()) {
+			return eliminate_dead(test->value ? e->body : e->elseBody, vars);
+		}
+	} else if (const EVar* e = expr->as<EVar>()) {
+		vars.insert(e->value);
+		return expr;
+	}
+	expr->for_each_child([&vars](Expr*& child) {
+		child = eliminate_dead(child, vars);
+	});
+	return expr;
+}
+
+Expr* Optimizer::optimize(Expr* ast) {
+	// removing dead bindings can expose more calls to inline, so repeat
+	// while the program keeps shrinking
+	int oldSize = size(ast);
+	for (int round = 0; round < maxRounds; ++round) {
+		ast = inline_functions(ast);
+		ast = fold_constants(ast);
+		ast = eliminate_dead_code(ast);
+		int newSize = size(ast);
+		if (newSize >= oldSize) { break; }
+		oldSize = newSize;
+	}
+	ast = eliminate_common_subexprs(ast);
+	return ast;
+}
+
+Expr* Optimizer::eliminate_dead_code(Expr* expr) {
+	std::unordered_set<std::string> vars;
+	return eliminate_dead(expr, vars);
+}
+
+// shares every repeated subexpression in one pass over the flat AST: each
+// occurrence gets a value number, the innermost binder of its free variables
+// and the outermost node it is always evaluated with; the let for a class of
+// equal occurrences goes on the outermost node that is both in scope of that
+// binder and evaluates one of them unconditionally, and covers every other
+// occurrence below it
+Expr* Optimizer::eliminate_common_subexprs(Expr* expr) {
+	FlatAst ast(expr);
+	std::vector<uint32_t> numbers = ast.value_numbers();
+	std::vector<uint32_t> binders = ast.binders();
+	std::vector<uint32_t> parents = ast.parents();
+
+	// as Runtime::is_expensive
+	std::vector<bool> expensive(ast.size());
+	for (uint32_t node = 0; node < ast.size(); ++node) {
+		FlatAst::Kind kind = ast.kinds[node];
+		bool costly = kind == FlatAst::Kind::BinaryOp || kind == FlatAst::Kind::UnaryOp
+		              || kind == FlatAst::Kind::If || kind == FlatAst::Kind::Let;
+		expensive[node] = kind == FlatAst::Kind::FunAp;
+		for (uint32_t i = 0; i < ast.num_children(node); ++i) {
+			expensive[node] = expensive[node] || costly && expensive[ast.child(node, i)];
+		}
+	}
+
+	// depth of each node, and the outermost node whose evaluation always
+	// evaluates it (parents come after their children, so go backwards)
+	std::vector<uint32_t> depths(ast.size(), 0);
+	std::vector<uint32_t> strictTops(ast.size(), ast.root());
+	for (uint32_t node = ast.size(); node-- > 0;) {
+		FlatAst::Kind kind = ast.kinds[node];
+		for (uint32_t i = 0; i < ast.num_children(node); ++i) {
+			bool strict = true;
+			if (kind == FlatAst::Kind::If) {
+				strict = i == 0;
+			} else if (kind == FlatAst::Kind::Let) {
+				strict = i == 1 || ast.payloads[node] & 1;
+			} else if (kind == FlatAst::Kind::Fun || kind == FlatAst::Kind::Fix) {
+				strict = false;
+			}
+			uint32_t child = ast.child(node, i);
+			depths[child] = depths[node] + 1;
+			strictTops[child] = strict ? strictTops[node] : child;
+		}
+	}
+
+	// innermost binder of a free variable of each node: paint the path from
+	// each variable up to its binder, innermost binders first, skipping the
+	// nodes already painted
+	std::vector<uint32_t> limits(ast.size(), FlatAst::none);
+	std::vector<uint32_t> vars;
+	for (uint32_t node = 0; node < ast.size(); ++node) {
+		if (ast.kinds[node] == FlatAst::Kind::Var && binders[node] != FlatAst::none) {
+			vars.push_back(node);
+		}
+	}
+	std::stable_sort(vars.begin(), vars.end(), [&](uint32_t a, uint32_t b) {
+		return depths[binders[a]] > depths[binders[b]];
+	});
+	// nearest unpainted ancestor of each node, found as in DeadNodes
+	std::vector<uint32_t> unpainted(ast.size());
+	for (uint32_t node = 0; node < ast.size(); ++node) { unpainted[node] = node; }
+	auto find_unpainted = [&](uint32_t node) {
+		while (unpainted[node] != node) {
+			unpainted[node] = unpainted[unpainted[node]];
+			node = unpainted[node];
+		}
+		return node;
+	};
+	for (uint32_t var : vars) {
+		uint32_t binder = binders[var];
+		// the binder is an ancestor, so the nodes below it come before it
+		for (uint32_t node = find_unpainted(var); node < binder; node = find_unpainted(node)) {
+			limits[node] = binder;
+			unpainted[node] = parents[node];
+		}
+	}
+
+	// occurrences of each class of equal expressions with the same binder
+	// limit, in postorder
+	std::unordered_map<uint64_t, uint32_t> classIds;
+	std::vector<std::vector<uint32_t>> classes;
+	std::vector<uint32_t> classOf(ast.size(), FlatAst::none);
+	// where each occurrence's let would go
+	std::vector<uint32_t> places(ast.size(), FlatAst::none);
+	std::vector<uint32_t> candidates;
+	for (uint32_t node = 0; node < ast.root(); ++node) {
+		if (!expensive[node]) { continue; }
+		uint64_t key = (uint64_t)numbers[node] << 32 | limits[node];
+		auto inserted = classIds.emplace(key, classes.size());
+		if (inserted.second) { classes.emplace_back(); }
+		classOf[node] = inserted.first->second;
+		classes[classOf[node]].push_back(node);
+		places[node] = strictTops[node];
+		if (limits[node] != FlatAst::none) {
+			places[node] = std::min(places[node], ast.scope(limits[node]));
+		}
+		candidates.push_back(node);
+	}
+	// outer places first (an ancestor comes after its descendants), and
+	// larger expressions first, so that a let for a part of a shared
+	// expression is bound outside the let for the whole
+	std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+		if (places[a] != places[b]) { return places[a] > places[b]; }
+		if (ast.sizes[a] != ast.sizes[b]) { return ast.sizes[a] > ast.sizes[b]; }
+		if (classOf[a] != classOf[b]) { return classOf[a] < classOf[b]; }
+		return a < b;
+	});
+
+	// shared by the runs of batch and serve modes
+	static std::atomic<int> counter{ 0 };
+	DeadNodes deadNodes(ast.size());
+	std::vector<bool> taken(ast.size(), false);
+	for (uint32_t candidate : candidates) {
+		if (taken[candidate] || deadNodes.dead(candidate)) { continue; }
+		uint32_t place = places[candidate];
+		const std::vector<uint32_t>& occurrences = classes[classOf[candidate]];
+		auto begin = std::lower_bound(occurrences.begin(), occurrences.end(), ast.first(place));
+		auto end = std::upper_bound(begin, occurrences.end(), place);
+		std::vector<uint32_t> live;
+		for (auto it = begin; it != end; ++it) {
+			taken[*it] = true;
+			if (!deadNodes.dead(*it)) { live.push_back(*it); }
+		}
+		if (live.size() < 2) { continue; }
+		// the candidate itself is evaluated whenever place is
+		uint32_t kept = candidate;
+		Expr* value = *ast.slots[kept];
+		// '$' cannot appear in source identifiers, so the name is fresh
+		std::string name = "$" + std::to_string(counter++);
+		for (uint32_t occurrence : live) {
+			*ast.slots[occurrence] = new EVar(value->loc, nullptr, name);
+			if (occurrence != kept) { deadNodes.kill(ast.first(occurrence), occurrence); }
+		}
+		Expr** slot = ast.slots[place];
+		ELet* let = new ELet((*slot)->loc, nullptr, new EVar(value->loc, nullptr, name), value, *slot, true);
+		*slot = let;
+		ast.slots[kept] = &let->value;
+	}
+	return expr;
+}
+
+Expr* Optimizer::inline_functions(Expr* expr) {
+	InlineScope scope;
+	return inline_expr(expr, scope);
+}
+
+int Optimizer::size(Expr* expr) {
+	// iterative, as --stats counts the nodes of arbitrarily deep programs
+	int result = 0;
+	std::vector<Expr*> stack{ expr };
+	while (!stack.empty()) {
+		Expr* node = stack.back();
+		stack.pop_back();
+		++result;
+		node->for_each_child([&stack](Expr*& child) {
+			stack.push_back(child);
+		});
+	}
+	return result;
+}
+
+Expr* Optimizer::fold_constants(Expr* expr) {
+	expr->for_each_child([](Expr*& child) {
+		child = fold_constants(child);
+	});
+	if (EBinaryOp* e = dynamic_cast<EBinaryOp*>(expr)) {
+		if (is_literal(e->left) && is_literal(e->right) && !traps(e)) {
+			Value* result = OpDefinition::binary_op_result(e->left->eval(), e->op.type, e->right->eval());
+			if (result) {
+				return Expr::from_value(result, e->loc);
+			}
+		}
+		return simplify(e);
+	} else if (EUnaryOp* e = dynamic_cast<EUnaryOp*>(expr)) {
+		if (is_literal(e->right)) {
+			Value* result = OpDefinition::unary_op_result(e->op.type, e->right->eval());
+			if (result) {
+				return Expr::from_value(result, e->loc);
+			}
+		}
+	} else if (EIf* e = dynamic_cast<EIf*>(expr)) {
+		if (const EBoolLit* test = e->test->as<EBoolLit>()) {
+			return test->value ? e->body : e->elseBody;
+		}
+	}
+	return expr;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Expr.h"
+
+// AST-to-AST optimization passes, run between type checking and evaluation
+// passes may rewrite the tree in place; each returns the new root
+class Optimizer {
+public:
+	// runs every pass in order
+	static Expr* optimize(Expr* ast);
+
+	// folds operations on literals, using OpDefinition so that results match
+	// eval() exactly; also simplifies conditionals on literal tests and
+	// identities such as x * 1 and x + 0
+	static Expr* fold_constants(Expr* expr);
+
+	// beta-reduces applications of small, non-recursive functions that are
+	// known at compile time (fun literals, and let-bound funs and their aliases)
+	static Expr* inline_functions(Expr* expr);
+
+	// removes let bindings that are never referenced (lazy bindings are never
+	// evaluated, so this only saves work), fix expressions that never recurse
+	// and branches of conditionals on literal tests
+	static Expr* eliminate_dead_code(Expr* expr);
+
+	// binds each repeated subexpression once with a strict let and reuses the
+	// result; only expressions that apply a function are worth sharing, and
+	// one occurrence must be evaluated unconditionally so that no work is
+	// added; takes O(n log n) time in the size of the program
+	static Expr* eliminate_common_subexprs(Expr* expr);
+
+	// largest function body (in AST nodes) that may be inlined
+	static const int maxInlineSize = 40;
+	// total nodes that inlining may add to the program
+	static const int inlineBudget = 2000;
+
+	// most rounds of inlining, folding and dead code elimination
+	static const int maxRounds = 4;
+
+	// number of AST nodes in expr
+	static int size(Expr* expr);
+};
@@ -0,0 +1,110 @@
+#include <exception>
+#include <vector>
+#include "ParallelChecker.h"
+#include "Source.h"
+#include "Runtime.h"
+#include "ThreadPool.h"
+
+bool ParallelChecker::enabled = false;
+
+thread_local int ParallelChecker::forkDepth = 0;
+
+void ParallelChecker::enable() {
+	enabled = true;
+	Context<const Type*>::is_open = [](const Type* type) {
+		return !is_closed(type);
+	};
+}
+
+bool ParallelChecker::should_fork(const Expr* first, const Expr* second, const Context<const Type*>& typeCtx) {
+	return Runtime::pool && forkDepth < Runtime::forkDepthLimit && typeCtx.open_count() == 0
+		&& both_at_least(first, second, minForkSize);
+}
+
+bool ParallelChecker::both_at_least(const Expr* first, const Expr* second, int size) {
+	// for_each_child only reads the children here
+	std::vector<Expr*> firstStack{ const_cast<Expr*>(first) };
+	std::vector<Expr*> secondStack{ const_cast<Expr*>(second) };
+	auto visit = [](std::vector<Expr*>& stack) {
+		Expr* expr = stack.back();
+		stack.pop_back();
+		expr->for_each_child([&](Expr*& child) {
+			stack.push_back(child);
+		});
+	};
+	for (int seen = 0; seen < size; ++seen) {
+		if (firstStack.empty() || secondStack.empty()) { return false; }
+		visit(firstStack);
+		visit(secondStack);
+	}
+	return true;
+}
+
+bool ParallelChecker::fork(Context<const Type*>& typeCtx, const Check& checkFirst, const Check& checkSecond) {
+	int depth = forkDepth;
+	int level = TVar::current_level();
+	// typeCtx is left alone until both checks are done
+	Context<const Type*> firstCtx(&typeCtx);
+	Context<const Type*> secondCtx(&typeCtx);
+	Source::ErrorBuffer firstErrors;
+	bool firstOk = false;
+	std::exception_ptr firstException;
+	ThreadPool::Task task([&]() {
+		// the task may run on another thread, or on this one while it waits
+		int savedDepth = forkDepth;
+		int savedLevel = TVar::current_level();
+		forkDepth = depth + 1;
+		TVar::set_current_level(level);
+		{
+			Source::ErrorBuffer::Scope errors(firstErrors);
+			try {
+				firstOk = checkFirst(firstCtx);
+			} catch (...) {
+				firstException = std::current_exception();
+			}
+		}
+		forkDepth = savedDepth;
+		TVar::set_current_level(savedLevel);
+	});
+	Runtime::pool->spawn(&task);
+	forkDepth = depth + 1;
+	Source::ErrorBuffer secondErrors;
+	bool secondOk = false;
+	std::exception_ptr secondException;
+	{
+		Source::ErrorBuffer::Scope errors(secondErrors);
+		try {
+			secondOk = checkSecond(secondCtx);
+		} catch (...) {
+			secondException = std::current_exception();
+		}
+	}
+	Runtime::pool->wait(&task);
+	forkDepth = depth;
+	if (firstException) {
+		std::rethrow_exception(firstException);
+	}
+	firstErrors.commit();
+	// the sequential checker stops at the first failure
+	if (!firstOk) { return false; }
+	if (secondException) {
+		std::rethrow_exception(secondException);
+	}
+	secondErrors.commit();
+	return secondOk;
+}
+
+bool ParallelChecker::is_closed(const Type* type) {
+	type = Type::resolve(type);
+	if (const TVar* var = dynamic_cast<const TVar*>(type)) {
+		return var->level == TVar::genericLevel;
+	} else if (const TArrow* arrow = dynamic_cast<const TArrow*>(type)) {
+		return is_closed(arrow->left) && is_closed(arrow->right);
+	} else if (const TTuple* tuple = dynamic_cast<const TTuple*>(type)) {
+		for (const Type* element : tuple->types) {
+			if (!is_closed(element)) { return false; }
+		}
+	}
+	// records and variants only hold annotated types, which have no variables
+	return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+#include "Type.h"
+#include "Expr.h"
+#include "Context.h"
+
+// opt-in parallel type checking (--parallel-check, on the pool of --parallel=N)
+// two sibling subtrees are checked as tasks when their checks cannot
+// interact: no type in the context they share has a variable left to bind,
+// so each check only binds variables it created itself; the context counts
+// its open entries as they are pushed, so this test is constant time
+// subtrees smaller than minForkSize are not worth a task, and are checked
+// sequentially
+// as in parallel evaluation (see Runtime::eval_operands), checks nested more
+// than Runtime::forkDepthLimit forks deep are sequential
+// diagnostics are buffered per task and committed as the sequential checker
+// would have reported them (Source sorts them), so the output is unchanged
+class ParallelChecker {
+public:
+	static bool enabled;
+
+	static const int minForkSize = 256;
+
+	using Check = std::function<bool(Context<const Type*>&)>;
+
+	// sets enabled, and has type contexts count their open entries; call
+	// before any context is built
+	static void enable();
+
+	// same as checkFirst(typeCtx) && checkSecond(typeCtx), where checkFirst
+	// checks first and checkSecond checks second and each leaves typeCtx as it
+	// found it; with a fork, each check gets a context over the unchanged
+	// typeCtx, checkFirst runs on the pool, and the errors of checkSecond are
+	// dropped if checkFirst fails
+	template <typename CheckFirst, typename CheckSecond>
+	static bool check_both(const Expr* first, const Expr* second, Context<const Type*>& typeCtx, CheckFirst checkFirst, CheckSecond checkSecond) {
+		if (!enabled || !should_fork(first, second, typeCtx)) {
+			return checkFirst(typeCtx) && checkSecond(typeCtx);
+		}
+		return fork(typeCtx, checkFirst, checkSecond);
+	}
+
+private:
+	static thread_local int forkDepth;
+
+	static bool should_fork(const Expr* first, const Expr* second, const Context<const Type*>& typeCtx);
+	// true if both subtrees have at least size nodes; walks them side by side,
+	// so it visits at most twice the smaller one (and no more than 2 * size)
+	static bool both_at_least(const Expr* first, const Expr* second, int size);
+	static bool fork(Context<const Type*>& typeCtx, const Check& checkFirst, const Check& checkSecond);
+
+	// true if type has no variables but generic ones (which are only read)
+	static bool is_closed(const Type* type);
+};
@@ -1,239 +1,269 @@
 #include "Parser.h"
 
 Expr* Parser::parse_expr(int minBindingPower, bool reportErrors) {
-	Token peek = tokens.front();
-	Expr* lhs = nullptr;
-	switch (peek.type) {
-	case TokenType::IntLit: {
-		// IntLit
-		tokens.pop_front();
-		long long value;
-		try {
-			value = std::stoll(peek.value);
-		} catch (std::exception&) {
-			peek.report_error_at_token("invalid int literal");
-			return nullptr;
+	// constructs waiting for their last operand; long chains of lets, ifs,
+	// funs and operators grow this stack instead of the native one
+	std::vector<PendingExpr> pending;
+	Expr* lhs = parse_operand(pending, minBindingPower, reportErrors);
+	while (true) {
+		if (!lhs) {
+			// a failed right operand ends its binary operation's expression at the
+			// left operand; every other construct fails with its last operand
+			while (!pending.empty() && !pending.back().binary) {
+				pending.pop_back();
+			}
+			if (pending.empty()) { return nullptr; }
+			lhs = pending.back().first;
+			minBindingPower = pending.back().minBindingPower;
+			pending.pop_back();
+		} else {
+			// handle recursive cases with Pratt parsing
+			bool parsingOperand = false;
+			while (!parsingOperand) {
+				Token peek = tokens.front();
+				switch (peek.type) {
+				case TokenType::Mul:
+				case TokenType::Div:
+				case TokenType::Mod:
+				case TokenType::Plus:
+				case TokenType::Minus:
+				case TokenType::Equals:
+				case TokenType::NotEquals:
+				case TokenType::Lt:
+				case TokenType::Gt:
+				case TokenType::Leq:
+				case TokenType::Geq:
+				case TokenType::And:
+				case TokenType::Or: {
+					// handle <EBinaryOp>: the right operand is parsed next, and
+					// the operation is built once it is complete
+					BindingPower bindingPower = BindingPower::BinOp(peek);
+					if (bindingPower.left < minBindingPower) { break; }
+					tokens.pop_front();
+					pending.push_back({ peek, true, minBindingPower, lhs });
+					minBindingPower = bindingPower.right;
+					lhs = parse_operand(pending, minBindingPower, true);
+					parsingOperand = true;
+					continue;
+				}
+				default: {
+					// handle <EFunAp>
+					BindingPower bindingPower = BindingPower::FunAp();
+					if (bindingPower.left < minBindingPower) { break; }
+					// it's a little hacky to call parse_expr to check if we can create a EFunAp..
+					// this trick relies on parse_expr not chomping tokens if it returns a nullptr
+					Expr* rhs = parse_expr(bindingPower.right, false);
+					if (!rhs) { break; }
+					lhs = new EFunAp(lhs->loc, nullptr, lhs, rhs);
+					continue;
+				}
+				}
+				break;
+			}
+			if (parsingOperand) { continue; }
 		}
-		lhs = new EIntLit(peek.loc, nullptr, value);
-		break;
-	}
-	case TokenType::FloatLit: {
-		// FloatLit
-		tokens.pop_front();
-		double value;
-		try {
-			value = std::stod(peek.value);
-		} catch (std::exception&) {
-			peek.report_error_at_token("invalid double literal");
-			return nullptr;
+		// check for type annotation
+		if (tokens.front().type == TokenType::Colon) {
+			tokens.pop_front();
+			const Type* typeAnn = parse_type_expr();
+			if (!typeAnn) {
+				lhs = nullptr;
+				continue;
+			}
+			lhs->typeAnn = typeAnn;
 		}
-		lhs = new EFloatLit(peek.loc, nullptr, value);
-		break;
-	}
-	case TokenType::True: {
-		// BoolLit(true)
-		tokens.pop_front();
-		lhs = new EBoolLit(peek.loc, nullptr, true);
-		break;
-	}
-	case TokenType::False: {
-		// BoolLit(false)
-		tokens.pop_front();
-		lhs = new EBoolLit(peek.loc, nullptr, false);
-		break;
-	}
-	case TokenType::Ident: {
-		// Ident
-		tokens.pop_front();
-		lhs = new EVar(peek.loc, nullptr, peek.value);
-		break;
+		if (pending.empty()) { return lhs; }
+		// lhs completes the innermost pending construct
+		PendingExpr top = pending.back();
+		pending.pop_back();
+		minBindingPower = top.minBindingPower;
+		lhs = complete(top, lhs);
 	}
-	case TokenType::LeftParen: {
-		// '(' <Expr> ')' or <EUnitLit>
-		tokens.pop_front();
-		if (tokens.front().type == TokenType::RightParen) {
-			// <EUnitLit>
+}
+
+Expr* Parser::parse_operand(std::vector<PendingExpr>& pending, int& minBindingPower, bool reportErrors) {
+	while (true) {
+		Token peek = tokens.front();
+		switch (peek.type) {
+		case TokenType::IntLit: {
+			// IntLit
 			tokens.pop_front();
-			lhs = new EUnitLit(peek.loc, Type::Unit());
-		} else {
-			// '(' <Expr> ')'
-			lhs = parse_expr();
-			if (!lhs) { return nullptr; }
-			if (!expect_token(TokenType::RightParen)) { return nullptr; }
+			long long value;
+			try {
+				value = std::stoll(peek.value);
+			} catch (std::out_of_range&) {
+				// too large for a long long
+				BigInt big;
+				if (!BigInt::parse(peek.value, big)) {
+					peek.report_error_at_token("invalid int literal");
+					return nullptr;
+				}
+				return new EIntLit(peek.loc, nullptr, 0, new BigInt(big));
+			} catch (std::exception&) {
+				peek.report_error_at_token("invalid int literal");
+				return nullptr;
+			}
+			return new EIntLit(peek.loc, nullptr, value);
 		}
-		break;
-	}
-	case TokenType::LeftBrace: {
-		// <ERecordLit>
-		std::vector<ERecordLit::Field> fields;
-		std::unordered_set<std::string> identsUsed; // prevent duplicate idents
-		// parse fields
-		do {
-			// on the first loop, this will pop the LeftBrace;
-			// on subsequent loops, it will pop the comma
-			// (kinda hacky, but reduces code duplication)
+		case TokenType::FloatLit: {
+			// FloatLit
 			tokens.pop_front();
-			std::optional<Token> ident = expect_token(TokenType::Ident);
-			if (!ident) { return nullptr; }
-			if (!expect_token(TokenType::Equals)) { return nullptr; }
-			Expr* expr = parse_expr();
-			if (!expr) { return nullptr; }
-			if (!identsUsed.insert(ident->value).second) {
-				peek.report_error_at_token("duplicate record field '" + ident->value + "'");
+			double value;
+			try {
+				value = std::stod(peek.value);
+			} catch (std::exception&) {
+				peek.report_error_at_token("invalid double literal");
 				return nullptr;
 			}
-			fields.push_back({ ident->value, expr });
-		} while (tokens.front().type == TokenType::Comma);
-		if (!expect_token(TokenType::RightBrace)) { return nullptr; }
-		lhs = new ERecordLit(peek.loc, nullptr, fields);
-		// match type based on idents
-		for (auto& entry : typeTable) {
-			const TRecord* recordType = entry.second->as<TRecord>();
-			if (!recordType) { continue; }
-			if (recordType->fields.size() != fields.size()) { continue; }
-			bool isMatch = true;
-			for (auto& field : fields) {
-				if (recordType->fields.find(field.ident) == recordType->fields.end()) {
-					isMatch = false;
-					break;
+			return new EFloatLit(peek.loc, nullptr, value);
+		}
+		case TokenType::True: {
+			// BoolLit(true)
+			tokens.pop_front();
+			return new EBoolLit(peek.loc, nullptr, true);
+		}
+		case TokenType::False: {
+			// BoolLit(false)
+			tokens.pop_front();
+			return new EBoolLit(peek.loc, nullptr, false);
+		}
+		case TokenType::Ident: {
+			// Ident
+			tokens.pop_front();
+			return new EVar(peek.loc, nullptr, peek.value);
+		}
+		case TokenType::LeftParen: {
+			// '(' <Expr> ')' or <EUnitLit>
+			tokens.pop_front();
+			if (tokens.front().type == TokenType::RightParen) {
+				// <EUnitLit>
+				tokens.pop_front();
+				return new EUnitLit(peek.loc, Type::Unit());
+			}
+			// '(' <Expr> ')'
+			Expr* expr = parse_expr();
+			if (!expr) { return nullptr; }
+			if (!expect_token(TokenType::RightParen)) { return nullptr; }
+			return expr;
+		}
+		case TokenType::LeftBrace: {
+			// <ERecordLit>
+			std::vector<ERecordLit::Field> fields;
+			std::unordered_set<std::string> identsUsed; // prevent duplicate idents
+			// parse fields
+			do {
+				// on the first loop, this will pop the LeftBrace;
+				// on subsequent loops, it will pop the comma
+				// (kinda hacky, but reduces code duplication)
+				tokens.pop_front();
+				std::optional<Token> ident = expect_token(TokenType::Ident);
+				if (!ident) { return nullptr; }
+				if (!expect_token(TokenType::Equals)) { return nullptr; }
+				Expr* expr = parse_expr();
+				if (!expr) { return nullptr; }
+				if (!identsUsed.insert(ident->value).second) {
+					peek.report_error_at_token("duplicate record field '" + ident->value + "'");
+					return nullptr;
+				}
+				fields.push_back({ ident->value, expr });
+			} while (tokens.front().type == TokenType::Comma);
+			if (!expect_token(TokenType::RightBrace)) { return nullptr; }
+			Expr* record = new ERecordLit(peek.loc, nullptr, fields);
+			// match type based on idents
+			for (auto& entry : typeTable) {
+				const TRecord* recordType = entry.second->as<TRecord>();
+				if (!recordType) { continue; }
+				if (recordType->fields.size() != fields.size()) { continue; }
+				bool isMatch = true;
+				for (auto& field : fields) {
+					if (recordType->fields.find(field.ident) == recordType->fields.end()) {
+						isMatch = false;
+						break;
+					}
 				}
+				if (!isMatch) { continue; }
+				record->typeAnn = recordType;
+			}
+			if (!record->typeAnn) {
+				peek.report_error_at_token("unable to match record type for identifier set");
+				return nullptr;
 			}
-			if (!isMatch) { continue; }
-			lhs->typeAnn = recordType;
+			return record;
 		}
-		if (!lhs->typeAnn) {
-			peek.report_error_at_token("unable to match record type for identifier set");
-			return nullptr;
+		case TokenType::Let: {
+			// <ELet>
+			tokens.pop_front();
+			EVar* varExpr = parse_ident();
+			if (!varExpr) { return nullptr; }
+			if (!expect_token(TokenType::Equals)) { return nullptr; }
+			Expr* value = parse_expr();
+			if (!value) { return nullptr; }
+			if (!expect_token(TokenType::In)) { return nullptr; }
+			pending.push_back({ peek, false, minBindingPower, value, nullptr, varExpr });
+			break;
 		}
-		break;
-	}
-	case TokenType::Let: {
-		// <ELet>
-		tokens.pop_front();
-		EVar* varExpr = parse_ident();
-		if (!varExpr) { return nullptr; }
-		if (!expect_token(TokenType::Equals)) { return nullptr; }
-		Expr* value = parse_expr();
-		if (!value) { return nullptr; }
-		if (!expect_token(TokenType::In)) { return nullptr; }
-		Expr* body = parse_expr();
-		if (!body) { return nullptr; }
-		lhs = new ELet(peek.loc, nullptr, varExpr, value, body);
-		break;
-	}
-	case TokenType::If: {
-		// <EIf>
-		tokens.pop_front();
-		Expr* test = parse_expr();
-		if (!test) { return nullptr; }
-		if (!expect_token(TokenType::Then)) { return nullptr; }
-		Expr* body = parse_expr();
-		if (!body) { return nullptr; }
-		if (!expect_token(TokenType::Else)) { return nullptr; }
-		Expr* elseBody = parse_expr();
-		if (!elseBody) { return nullptr; }
-		lhs = new EIf(peek.loc, nullptr, test, body, elseBody);
-		break;
-	}
-	case TokenType::Fun: {
-		// <EFun>
-		tokens.pop_front();
-		EVar* varExpr = parse_ident();
-		if (!varExpr) { return nullptr; }
-		if (!expect_token(TokenType::Arrow)) { return nullptr; }
-		Expr* body = parse_expr();
-		if (!body) { return nullptr; }
-		lhs = new EFun(peek.loc, nullptr, varExpr, body);
-		break;
-	}
-	case TokenType::Fix: {
-		// <EFix>
-		tokens.pop_front();
-		EVar* varExpr = parse_ident();
-		if (!varExpr) { return nullptr; }
-		if (!expect_token(TokenType::Arrow)) { return nullptr; }
-		Expr* body = parse_expr();
-		if (!body) { return nullptr; }
-		lhs = new EFix(peek.loc, nullptr, varExpr, body);
-		break;
-	}
-	case TokenType::Minus: {
-		// '-' <Expr>
-		tokens.pop_front();
-		Expr* right = parse_expr();
-		if (!right) { return nullptr; }
-		lhs = new EUnaryOp(peek.loc, nullptr, peek, right);
-		break;
-	}
-	case TokenType::Not: {
-		// '!' <Expr>
-		tokens.pop_front();
-		Expr* right = parse_expr();
-		if (!right) { return nullptr; }
-		lhs = new EUnaryOp(peek.loc, nullptr, peek, right);
-		break;
-	}
-	default: {
-		// unexpected token
-		if (reportErrors) {
-			std::ostringstream oss;
-			oss << "expected expression; got token '" << peek.type << "'";
-			peek.report_error_at_token(oss.str());
+		case TokenType::If: {
+			// <EIf>
+			tokens.pop_front();
+			Expr* test = parse_expr();
+			if (!test) { return nullptr; }
+			if (!expect_token(TokenType::Then)) { return nullptr; }
+			Expr* body = parse_expr();
+			if (!body) { return nullptr; }
+			if (!expect_token(TokenType::Else)) { return nullptr; }
+			pending.push_back({ peek, false, minBindingPower, test, body });
+			break;
+		}
+		case TokenType::Fun:
+		case TokenType::Fix: {
+			// <EFun> or <EFix>
+			tokens.pop_front();
+			EVar* varExpr = parse_ident();
+			if (!varExpr) { return nullptr; }
+			if (!expect_token(TokenType::Arrow)) { return nullptr; }
+			pending.push_back({ peek, false, minBindingPower, nullptr, nullptr, varExpr });
+			break;
 		}
-		return nullptr;
-	}
-	}
-	// handle recursive cases with Pratt parsing
-	while (true) {
-		peek = tokens.front();
-		bool matched = false;
-		switch (peek.type) {
-		case TokenType::Mul:
-		case TokenType::Div:
-		case TokenType::Mod:
-		case TokenType::Plus:
 		case TokenType::Minus:
-		case TokenType::Equals:
-		case TokenType::NotEquals:
-		case TokenType::Lt:
-		case TokenType::Gt:
-		case TokenType::Leq:
-		case TokenType::Geq:
-		case TokenType::And:
-		case TokenType::Or: {
-			// handle <EBinaryOp>
-			BindingPower bindingPower = BindingPower::BinOp(peek);
-			if (bindingPower.left < minBindingPower) { break; }
+		case TokenType::Not: {
+			// '-' <Expr> or '!' <Expr>
 			tokens.pop_front();
-			Expr* rhs = parse_expr(bindingPower.right);
-			if (!rhs) { break; }
-			matched = true;
-			lhs = new EBinaryOp(lhs->loc, nullptr, lhs, peek, rhs);
+			pending.push_back({ peek, false, minBindingPower });
 			break;
 		}
 		default: {
-			// handle <EFunAp>
-			BindingPower bindingPower = BindingPower::FunAp();
-			if (bindingPower.left < minBindingPower) { break; }
-			// it's a little hacky to call parse_expr to check if we can create a EFunAp..
-			// this trick relies on parse_expr not chomping tokens if it returns a nullptr
-			Expr* rhs = parse_expr(bindingPower.right, false);
-			if (!rhs) { break; }
-			matched = true;
-			lhs = new EFunAp(lhs->loc, nullptr, lhs, rhs);
-			break;
+			// unexpected token
+			if (reportErrors) {
+				std::ostringstream oss;
+				oss << "expected expression; got token '" << peek.type << "'";
+				peek.report_error_at_token(oss.str());
+			}
+			return nullptr;
 		}
 		}
-		if (!matched) { break; }
+		// the construct's last operand is a whole expression
+		minBindingPower = 0;
+		reportErrors = true;
 	}
-	// check for type annotation
-	if (tokens.front().type == TokenType::Colon) {
-		tokens.pop_front();
-		const Type* typeAnn = parse_type_expr();
-		if (!typeAnn) { return nullptr; }
-		lhs->typeAnn = typeAnn;
+}
+
+Expr* Parser::complete(const PendingExpr& pending, Expr* last) {
+	const Token& token = pending.token;
+	switch (token.type) {
+	case TokenType::Let:
+		return new ELet(token.loc, nullptr, pending.ident, pending.first, last);
+	case TokenType::If:
+		return new EIf(token.loc, nullptr, pending.first, pending.second, last);
+	case TokenType::Fun:
+		return new EFun(token.loc, nullptr, pending.ident, last);
+	case TokenType::Fix:
+		return new EFix(token.loc, nullptr, pending.ident, last);
+	default:
+		if (pending.binary) {
+			return new EBinaryOp(pending.first->loc, nullptr, pending.first, token, last);
+		}
+		return new EUnaryOp(token.loc, nullptr, token, last);
 	}
-	return lhs;
 }
 
 EVar* Parser::parse_ident() {
@@ -384,3 +414,44 @@ std::optional<std::pair<std::string, Type*>> Parser::parse_type_decl() {
 	}
 	}
 }
+
+Expr* Parser::parse_entry(EVar*& ident) {
+	ident = nullptr;
+	parse_type_decls();
+	Token peek = tokens.front();
+	if (peek.type == TokenType::Eof) {
+		// type declarations only
+		return nullptr;
+	}
+	if (peek.type != TokenType::Let) {
+		Expr* expr = parse_expr();
+		if (expr) {
+			expect_token(TokenType::Eof);
+		}
+		return expr;
+	}
+	// same as <ELet>, except that the 'in' part is optional
+	tokens.pop_front();
+	EVar* varExpr = parse_ident();
+	if (!varExpr) { return nullptr; }
+	if (!expect_token(TokenType::Equals)) { return nullptr; }
+	Expr* value = parse_expr();
+	if (!value) { return nullptr; }
+	if (tokens.front().type == TokenType::Eof) {
+		ident = varExpr;
+		return value;
+	}
+	if (!expect_token(TokenType::In)) { return nullptr; }
+	Expr* body = parse_expr();
+	if (!body) { return nullptr; }
+	expect_token(TokenType::Eof);
+	return new ELet(peek.loc, nullptr, varExpr, value, body);
+}
+
+void Parser::parse_type_decls() {
+	while (tokens.front().type == TokenType::Type) {
+		std::optional<std::pair<std::string, Type*>> typeDecl = parse_type_decl();
+		if (!typeDecl) { break; }
+		typeTable[typeDecl->first] = typeDecl->second;
+	}
+}
@@ -32,13 +32,14 @@ class Parser {
 public:
 	Parser(std::deque<Token> tokens) : tokens(std::move(tokens)) {}
 
+	// types declared by earlier input (e.g. previous REPL entries) stay in scope
+	Parser(std::deque<Token> tokens, const std::unordered_map<std::string, const Type*>& declaredTypes)
+		: tokens(std::move(tokens)) {
+		typeTable.insert(declaredTypes.begin(), declaredTypes.end());
+	}
+
 	Expr* parse() {
-		// parse and register type declarations
-		while (tokens.front().type == TokenType::Type) {
-			std::optional<std::pair<std::string, Type*>> typeDecl = parse_type_decl();
-			if (!typeDecl) { break; }
-			typeTable[typeDecl->first] = typeDecl->second;
-		}
+		parse_type_decls();
 		// parse expression
 		Expr* expr = parse_expr();
 		if (expr) {
@@ -47,6 +48,15 @@ public:
 		return expr;
 	}
 
+	// REPL entry: a program, or a top-level definition 'let x = e' without 'in'
+	// (then ident is set to x and the value e is returned); returns nullptr
+	// without reporting errors if the entry only declares types
+	Expr* parse_entry(EVar*& ident);
+
+	const std::unordered_map<std::string, const Type*>& get_type_table() const {
+		return typeTable;
+	}
+
 private:
 	std::deque<Token> tokens;
 	std::unordered_map<std::string, const Type*> typeTable = {
@@ -115,10 +125,32 @@ private:
 		}
 	}
 
+	// a construct whose leading tokens and operands are parsed and whose last
+	// operand (a let body, else branch, fun body, right operand, ...) is not
+	struct PendingExpr {
+		Token token;
+		bool binary;
+		// of the expression the construct starts
+		int minBindingPower;
+		// let value, if test or binary operator's left operand
+		Expr* first = nullptr;
+		// if then-branch
+		Expr* second = nullptr;
+		// let, fun or fix binder
+		EVar* ident = nullptr;
+	};
+
 	// Non-terminals
 	// <Expr>
 	Expr* parse_expr(int minBindingPower = 0, bool reportErrors = true);
 
+	// parses prefix constructs onto pending until an atom, which is returned
+	// (minBindingPower becomes that of the atom's expression)
+	Expr* parse_operand(std::vector<PendingExpr>& pending, int& minBindingPower, bool reportErrors);
+
+	// builds pending with its last operand
+	static Expr* complete(const PendingExpr& pending, Expr* last);
+
 	// <EVar>
 	EVar* parse_ident();
 
@@ -127,4 +159,7 @@ private:
 
 	// type [name] = [type]
 	std::optional<std::pair<std::string, Type*>> parse_type_decl();
+
+	// parse and register type declarations
+	void parse_type_decls();
 };
@@ -0,0 +1,152 @@
+#include <map>
+#include <cstdio>
+#include <algorithm>
+#include "Profiler.h"
+#include "Expr.h"
+#include "expr/EFix.h"
+#include "expr/EFun.h"
+#include "expr/ELet.h"
+
+bool Profiler::enabled = false;
+thread_local Profiler::ThreadProfile* Profiler::profile = nullptr;
+std::mutex Profiler::mutex;
+std::vector<Profiler::ThreadProfile*> Profiler::profiles;
+std::unordered_map<long long, std::string> Profiler::names;
+
+long long Profiler::site(const Expr* fun) {
+	return (long long)fun->loc.line << 32 | (unsigned)fun->loc.colStart;
+}
+
+std::string Profiler::frame_name(long long site) {
+	auto it = names.find(site);
+	std::string name = it == names.end() ? "fun" : it->second;
+	return name + "@" + std::to_string((site >> 32) + 1) + ":" + std::to_string(site & 0xffffffff);
+}
+
+void Profiler::reset() {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (ThreadProfile* thread : profiles) {
+		std::vector<Node*> pending;
+		for (const auto& [key, child] : thread->root.children) {
+			pending.push_back(child);
+		}
+		while (!pending.empty()) {
+			Node* node = pending.back();
+			pending.pop_back();
+			for (const auto& [key, child] : node->children) {
+				pending.push_back(child);
+			}
+			delete node;
+		}
+		thread->root.children.clear();
+		thread->totals.clear();
+		thread->active.clear();
+	}
+	names.clear();
+}
+
+void Profiler::name_functions(Expr* ast) {
+	if (const EFix* fix = ast->as<EFix>()) {
+		if (const EFun* fun = fix->body->as<EFun>()) {
+			names[site(fun)] = fix->ident->value;
+		}
+	} else if (const ELet* let = ast->as<ELet>()) {
+		if (const EFun* fun = let->value->as<EFun>()) {
+			names[site(fun)] = let->ident->value;
+		}
+	}
+	ast->for_each_child([](Expr*& child) {
+		name_functions(child);
+	});
+}
+
+void Profiler::enter(const Expr* fun) {
+	if (!profile) {
+		profile = new ThreadProfile();
+		std::lock_guard<std::mutex> lock(mutex);
+		profiles.push_back(profile);
+	}
+	long long key = site(fun);
+	Node* parent = profile->stack.empty() ? &profile->root : profile->stack.back().node;
+	Node*& node = parent->children[key];
+	if (!node) {
+		node = new Node{ parent, key };
+	}
+	++node->calls;
+	++profile->totals[key].calls;
+	++profile->active[key];
+	profile->stack.push_back({ node, Clock::now(), 0 });
+}
+
+void Profiler::leave() {
+	Frame frame = profile->stack.back();
+	profile->stack.pop_back();
+	long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - frame.start).count();
+	long long self = elapsed - frame.childNs;
+	frame.node->selfNs += self;
+	Totals& totals = profile->totals[frame.node->site];
+	totals.selfNs += self;
+	if (--profile->active[frame.node->site] == 0) {
+		totals.inclusiveNs += elapsed;
+	}
+	if (!profile->stack.empty()) {
+		profile->stack.back().childNs += elapsed;
+	}
+}
+
+void Profiler::write_folded(std::ostream& os) {
+	std::lock_guard<std::mutex> lock(mutex);
+	// identical stacks from different threads are merged
+	std::map<std::string, long long> stacks;
+	std::vector<std::pair<const Node*, std::string>> pending;
+	for (const ThreadProfile* thread : profiles) {
+		for (const auto& [key, child] : thread->root.children) {
+			pending.push_back({ child, frame_name(key) });
+		}
+	}
+	while (!pending.empty()) {
+		auto [node, path] = pending.back();
+		pending.pop_back();
+		stacks[path] += node->selfNs;
+		for (const auto& [key, child] : node->children) {
+			pending.push_back({ child, path + ";" + frame_name(key) });
+		}
+	}
+	for (const auto& [path, ns] : stacks) {
+		if (ns >= 1000) {
+			os << path << " " << ns / 1000 << "\n";
+		}
+	}
+	os << std::flush;
+}
+
+void Profiler::print_top(std::ostream& os, int n) {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::unordered_map<long long, Totals> merged;
+	long long totalNs = 0;
+	for (const ThreadProfile* thread : profiles) {
+		for (const auto& [key, totals] : thread->totals) {
+			Totals& sum = merged[key];
+			sum.calls += totals.calls;
+			sum.selfNs += totals.selfNs;
+			sum.inclusiveNs += totals.inclusiveNs;
+			totalNs += totals.selfNs;
+		}
+	}
+	std::vector<std::pair<long long, Totals>> sites(merged.begin(), merged.end());
+	std::sort(sites.begin(), sites.end(), [](const auto& a, const auto& b) {
+		return a.second.selfNs > b.second.selfNs;
+	});
+	char line[256];
+	snprintf(line, sizeof(line), "profile: %.3f ms in %zu functions\n%10s %7s %10s %12s  %s\n",
+	         totalNs / 1e6, sites.size(), "self ms", "self %", "incl ms", "calls", "function");
+	os << line;
+	for (int i = 0; i < n && i < (int)sites.size(); ++i) {
+		const Totals& totals = sites[i].second;
+		snprintf(line, sizeof(line), "%10.3f %6.1f%% %10.3f %12lld  %s\n",
+		         totals.selfNs / 1e6, totalNs ? 100.0 * totals.selfNs / totalNs : 0.0,
+		         totals.inclusiveNs / 1e6, totals.calls, frame_name(sites[i].first).c_str());
+		os << line;
+	}
+	os << std::flush;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <unordered_map>
+
+class Expr;
+
+// evaluation profiler (--profile)
+// every function application is a call of the applied fun, identified by its
+// source location (copies and substitutions keep locations); call counts and
+// self and inclusive time are kept per call stack, for folded-stack output,
+// and per function, for the top-N table
+// the profile is process-wide: each run resets it, and runs must not overlap
+// (batch and serve modes only allow --profile with -j 1)
+class Profiler {
+public:
+	static bool enabled;
+
+	// times one call while profiling is enabled
+	class Scope {
+	public:
+		Scope(const Expr* fun) : active(enabled) {
+			if (active) { enter(fun); }
+		}
+		~Scope() {
+			if (active) { leave(); }
+		}
+
+	private:
+		bool active;
+	};
+
+	// discards the calls and names of earlier runs; no calls may be in progress
+	static void reset();
+
+	// names the funs of ast after the let or fix binding them, for the report
+	static void name_functions(Expr* ast);
+
+	// one line per call stack: frames separated by ';', then self time in
+	// microseconds (the input format of flamegraph.pl)
+	static void write_folded(std::ostream& os);
+
+	// the n functions with the most self time
+	static void print_top(std::ostream& os, int n);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// call stack tree node
+	struct Node {
+		Node* parent;
+		long long site;
+		long long calls = 0;
+		long long selfNs = 0;
+		std::unordered_map<long long, Node*> children = {};
+	};
+
+	struct Frame {
+		Node* node;
+		Clock::time_point start;
+		long long childNs;
+	};
+
+	struct Totals {
+		long long calls = 0;
+		long long selfNs = 0;
+		long long inclusiveNs = 0;
+	};
+
+	// each thread profiles its own calls (forked evaluation starts new stacks)
+	struct ThreadProfile {
+		Node root{ nullptr, -1 };
+		std::vector<Frame> stack;
+		std::unordered_map<long long, Totals> totals;
+		// open frames per site; recursive calls only count toward inclusive
+		// time once, in their outermost frame
+		std::unordered_map<long long, int> active;
+	};
+
+	static thread_local ThreadProfile* profile;
+	static std::mutex mutex;
+	static std::vector<ThreadProfile*> profiles;
+	static std::unordered_map<long long, std::string> names;
+
+	static long long site(const Expr* fun);
+	static std::string frame_name(long long site);
+
+	static void enter(const Expr* fun);
+	static void leave();
+};
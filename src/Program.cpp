@@ -0,0 +1,212 @@
+#include <stdexcept>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include "Program.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Optimizer.h"
+#include "Runtime.h"
+
+namespace {
+
+// arguments are substituted into function bodies, which only read their location
+const Location argLocation{ nullptr, 0, 0, 0 };
+
+}
+
+Program::Arg::Arg(int value) : Arg((long long)value) {}
+
+Program::Arg::Arg(long long value)
+	: type(Type::Int()), literal(new EIntLit(argLocation, nullptr, value)) {}
+
+Program::Arg::Arg(const BigInt& value)
+	: type(Type::Int()), literal(value.fits_long_long()
+		? new EIntLit(argLocation, nullptr, value.to_long_long())
+		: new EIntLit(argLocation, nullptr, 0, new BigInt(value))) {}
+
+Program::Arg::Arg(double value)
+	: type(Type::Float()), literal(new EFloatLit(argLocation, nullptr, value)) {}
+
+Program::Arg::Arg(bool value)
+	: type(Type::Bool()), literal(new EBoolLit(argLocation, nullptr, value)) {}
+
+int Program::Function::arity() const {
+	int arity = 0;
+	for (const TArrow* arrow = type->as<TArrow>(); arrow; arrow = arrow->right->as<TArrow>()) {
+		++arity;
+	}
+	return arity;
+}
+
+Value* Program::Function::call(const std::vector<Arg>& args) const {
+	// diagnostics of this call only, as calls may run concurrently
+	Source::ErrorBuffer errors;
+	Source::ErrorBuffer::Scope scope(errors);
+	const Type* funType = type;
+	const Value* result = value;
+	for (size_t i = 0; i < args.size(); ++i) {
+		const TArrow* arrowType = funType->as<TArrow>();
+		if (!arrowType) {
+			throw std::invalid_argument(name + ": expected at most " + std::to_string(i) + " arguments");
+		}
+		// a polymorphic parameter accepts any argument
+		const Type* paramType = Type::resolve(arrowType->left);
+		if (!paramType->as<TVar>() && !paramType->equal(args[i].type)) {
+			std::ostringstream oss;
+			oss << name << ": expected argument " << i + 1 << " of type " << paramType << "; got " << args[i].type;
+			throw std::invalid_argument(oss.str());
+		}
+		// same as evaluating an application (see EFunAp::eval), minus the
+		// evaluation of the function and argument expressions
+		const VFun* funValue = result->as<VFun>();
+		const EFun* funExpr = funValue ? funValue->fun->as<EFun>() : nullptr;
+		if (!funExpr) {
+			throw std::runtime_error("Failed to cast VFun fun to EFun");
+		}
+		Value* argValue = nullptr;
+		Value* next;
+		if (funValue->memo) {
+			argValue = args[i].literal->eval();
+			if (funValue->memo->lookup(argValue, next)) {
+				result = next;
+				funType = arrowType->right;
+				continue;
+			}
+		}
+		next = funExpr->body->subst(funExpr->ident->value, args[i].literal)->eval();
+		if (!next) {
+			std::ostringstream oss;
+			oss << name << ": evaluation failed";
+			if (!errors.empty()) {
+				oss << '\n';
+				errors.emit(oss);
+			}
+			throw std::runtime_error(oss.str());
+		}
+		if (funValue->memo) {
+			funValue->memo->insert(argValue, next);
+		}
+		result = next;
+		funType = arrowType->right;
+	}
+	return const_cast<Value*>(result);
+}
+
+Program* Program::compile(const std::string& text, std::ostream& errors, const std::string& filepath,
+                          bool optimize, bool memoize) {
+	std::istringstream is(text);
+	Program* program = new Program(is, filepath);
+	Source& source = program->source;
+
+	// lex and parse
+	Lexer lexer(source);
+	Parser parser(lexer.get_tokens());
+	Expr* root = source.has_errors() ? nullptr : parser.parse();
+	if (source.has_errors() || !root) {
+		source.emit_errors(errors);
+		return nullptr;
+	}
+
+	// type-check the outermost let chain one binding at a time (as REPL
+	// definitions are checked), so each top-level name keeps its own type
+	std::vector<std::pair<const ELet*, const Type*>> bindings;
+	Expr* ast = root;
+	while (const ELet* let = ast->as<ELet>()) {
+		const Type* type = ELet::binding_type(let->ident, let->value, program->typeCtx, true);
+		if (!type) { break; }
+		program->typeCtx.push(let->ident->value, type);
+		bindings.push_back({ let, type });
+		ast = let->body;
+	}
+	program->bodyType = source.has_errors() ? nullptr : ast->type_syn(program->typeCtx);
+	if (!source.has_errors() && !program->bodyType) {
+		throw std::runtime_error("Failed to synthesize type without reporting errors");
+	}
+	// the whole program has been checked, so operands still unknown default
+	if (program->bodyType) {
+		for (auto [let, type] : bindings) {
+			Type::default_operands(type);
+		}
+		Type::default_operands(program->bodyType);
+	}
+	if (source.has_errors()) {
+		source.emit_errors(errors);
+		return nullptr;
+	}
+
+	// a function is closed over the definitions it uses, and those over the
+	// ones they use; other definitions are never closed, since closing every
+	// definition would copy the whole let chain into each one
+	std::vector<Expr*> closed(bindings.size(), nullptr);
+	// scopes[i] maps the names visible to binding i to their bindings
+	std::vector<std::unordered_map<std::string, size_t>> scopes(bindings.size());
+	std::unordered_map<std::string, size_t> scope;
+	for (size_t i = 0; i < bindings.size(); ++i) {
+		std::unordered_set<std::string> freeVars;
+		bindings[i].first->value->free_vars(freeVars);
+		for (const std::string& ident : freeVars) {
+			auto it = scope.find(ident);
+			if (it != scope.end()) {
+				scopes[i].insert(*it);
+			}
+		}
+		scope[bindings[i].first->ident->value] = i;
+	}
+	// optimization rewrites in place and may return a new root (CSE binds
+	// common subexpressions around it), so it gets a copy of the program's
+	// value and the root it returns is kept
+	std::function<Expr*(size_t)> close = [&](size_t i) {
+		if (closed[i]) { return closed[i]; }
+		Expr* expr = bindings[i].first->value->copy();
+		for (auto [ident, j] : scopes[i]) {
+			expr = expr->subst(ident, close(j));
+		}
+		if (optimize) {
+			expr = Optimizer::optimize(expr);
+		}
+		return closed[i] = expr;
+	};
+	for (size_t i = 0; i < bindings.size(); ++i) {
+		auto [let, type] = bindings[i];
+		if (!type->as<TArrow>()) {
+			program->functions.push(let->ident->value, nullptr);
+			continue;
+		}
+		// closed definitions are substituted into later ones, so memo tables go
+		// on a copy
+		Expr* expr = close(i);
+		if (memoize) {
+			expr = expr->copy();
+			Runtime::enable_memoization(expr);
+		}
+		Value* funValue = expr->eval();
+		if (!funValue || !funValue->as<VFun>()) {
+			source.emit_errors(errors);
+			return nullptr;
+		}
+		program->functions.push(let->ident->value, new Function(let->ident->value, type, funValue));
+	}
+	// the body runs as part of the whole program, as alc would run it
+	program->body = optimize ? Optimizer::optimize(root) : root;
+	if (memoize) {
+		Runtime::enable_memoization(program->body);
+	}
+	return program;
+}
+
+Value* Program::run(std::ostream& errors) const {
+	Value* value = body->eval();
+	if (!value) {
+		source.emit_errors(errors);
+	}
+	return value;
+}
+
+const Program::Function* Program::function(const std::string& name) const {
+	return functions.get(name);
+}
+
+const Type* Program::type_of(const std::string& name) const {
+	return typeCtx.get(name);
+}
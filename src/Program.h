@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include "Expr.h"
+#include "Source.h"
+#include "Context.h"
+#include "value/VInt.h"
+#include "value/VFloat.h"
+#include "value/VBool.h"
+#include "value/VUnit.h"
+#include "value/VFun.h"
+
+// embedding API (libal.a): compile a program once, then call its top-level
+// functions any number of times without lexing, parsing or type checking
+//
+//   Program* program = Program::compile(text, std::cerr);
+//   const Program::Function* fib = program->function("fib");
+//   long long n = fib->call({ 30 })->as<VInt>()->to_long_long();
+//
+// an int result that overflows a long long is a BigInt (see VInt), for which
+// to_long_long() throws; to_big() gives any int result
+//
+// the top-level definitions of a program are the bindings of its outermost
+// let chain ('let f = ... in let g = ... in body'); run() evaluates the body
+class Program {
+public:
+	// a native int, float or bool argument, or an int too large for a long long
+	class Arg {
+	public:
+		Arg(int value);
+		Arg(long long value);
+		Arg(const BigInt& value);
+		Arg(double value);
+		Arg(bool value);
+
+		const Type* type;
+		// literal substituted for the parameter
+		Expr* literal;
+	};
+
+	class Function {
+	public:
+		std::string name;
+		const Type* type;
+
+		// number of parameters before the result (curried)
+		int arity() const;
+
+		// applies the function to args, one at a time; fewer args than the
+		// arity give back a partially applied function
+		// throws std::invalid_argument if there are too many args or one has the
+		// wrong type, and std::runtime_error with the diagnostics if evaluation
+		// fails
+		// calls are independent and may run concurrently
+		Value* call(const std::vector<Arg>& args) const;
+
+	private:
+		// the evaluated (closed, optimized) function
+		const Value* value;
+
+		Function(std::string name, const Type* type, const Value* value)
+			: name(std::move(name)), type(type), value(value) {}
+
+		friend class Program;
+	};
+
+	// lexes, parses, type-checks and optimizes text (as --no-opt and --memo
+	// would, when those are set), then evaluates each top-level function;
+	// returns nullptr after writing diagnostics to errors
+	static Program* compile(const std::string& text, std::ostream& errors, const std::string& filepath = "",
+	                        bool optimize = true, bool memoize = false);
+
+	// evaluates the body; nullptr (after writing diagnostics) if evaluation fails
+	Value* run(std::ostream& errors) const;
+
+	// type of the body
+	const Type* type() const {
+		return bodyType;
+	}
+
+	// nullptr if the latest top-level definition of name is not a function
+	const Function* function(const std::string& name) const;
+
+	// type of a top-level definition, or nullptr
+	const Type* type_of(const std::string& name) const;
+
+private:
+	Source source;
+	Context<const Type*> typeCtx;
+	Context<const Function*> functions;
+	// the whole program, including the top-level definitions
+	Expr* body = nullptr;
+	const Type* bodyType = nullptr;
+
+	Program(std::istream& is, const std::string& filepath) : source(is, filepath) {}
+};
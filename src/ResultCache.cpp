@@ -0,0 +1,172 @@
+#include <vector>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include "AstCache.h"
+#include "ResultCache.h"
+
+std::string ResultCache::directory;
+uint64_t ResultCache::maxBytes = 64 << 20;
+std::atomic<long long> ResultCache::hits{ 0 };
+std::atomic<long long> ResultCache::misses{ 0 };
+std::atomic<long long> ResultCache::evictions{ 0 };
+
+namespace {
+
+const std::string header = "ALR2\n";
+const std::string extension = ".alr";
+// results may change when alc is rebuilt, so keys include the build (see
+// BUILD_STAMP in the Makefile)
+#ifndef BUILD_STAMP
+#define BUILD_STAMP __DATE__ " " __TIME__
+#endif
+const char* buildStamp = BUILD_STAMP;
+
+namespace fs = std::filesystem;
+
+}
+
+std::string ResultCache::normalize(const Expr* ast, const Type* type) {
+	std::ostringstream oss;
+	oss << std::hexfloat << buildStamp << "\n" << ast << "\n" << type;
+	return oss.str();
+}
+
+uint64_t ResultCache::key(const std::string& normalized) {
+	return AstCache::fnv1a(normalized.data(), normalized.size());
+}
+
+std::string ResultCache::path(uint64_t key) {
+	std::ostringstream oss;
+	oss << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << extension;
+	return oss.str();
+}
+
+// an entry is the header, the normalized program's size and a newline, the
+// normalized program and the result
+bool ResultCache::lookup(uint64_t key, const std::string& normalized, std::string& result) {
+	std::ifstream ifs(path(key), std::ios::binary);
+	std::string contents((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	std::string programHeader = header + std::to_string(normalized.size()) + "\n";
+	if (!ifs || contents.compare(0, programHeader.size(), programHeader) != 0
+	    || contents.compare(programHeader.size(), normalized.size(), normalized) != 0) {
+		++misses;
+		Totals delta;
+		delta.misses = 1;
+		record_stats(delta);
+		return false;
+	}
+	result = contents.substr(programHeader.size() + normalized.size());
+	// mark as recently used
+	std::error_code error;
+	fs::last_write_time(path(key), fs::file_time_type::clock::now(), error);
+	++hits;
+	Totals delta;
+	delta.hits = 1;
+	record_stats(delta);
+	return true;
+}
+
+void ResultCache::insert(uint64_t key, const std::string& normalized, const std::string& result) {
+	std::string contents = header + std::to_string(normalized.size()) + "\n" + normalized + result;
+	// a colliding entry is replaced
+	std::error_code error;
+	uint64_t replaced = fs::file_size(path(key), error);
+	bool replacing = !error;
+	if (AstCache::write_file(path(key), contents)) {
+		Totals delta;
+		delta.entries = replacing ? 0 : 1;
+		delta.bytes = (long long)contents.size() - (replacing ? (long long)replaced : 0);
+		record_stats(delta);
+	}
+}
+
+void ResultCache::evict(Totals& totals) {
+	struct Entry {
+		fs::path path;
+		fs::file_time_type time;
+		uint64_t size;
+	};
+	std::vector<Entry> entries;
+	uint64_t total = 0;
+	std::error_code error;
+	for (const fs::directory_entry& file : fs::directory_iterator(directory, error)) {
+		if (file.path().extension() != extension) { continue; }
+		Entry entry{ file.path(), file.last_write_time(error), file.file_size(error) };
+		if (error) { continue; }
+		total += entry.size;
+		entries.push_back(entry);
+	}
+	// the running totals drift if entries are removed by hand, or two
+	// processes replace the same entry at once; a count puts them right
+	totals.entries = entries.size();
+	totals.bytes = total;
+	if (total <= maxBytes) { return; }
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+		return a.time < b.time;
+	});
+	long long evicted = 0;
+	for (const Entry& entry : entries) {
+		if (total <= maxBytes) { break; }
+		if (fs::remove(entry.path, error)) {
+			total -= entry.size;
+			--totals.entries;
+			++evicted;
+		}
+	}
+	totals.bytes = total;
+	totals.evictions += evicted;
+	evictions += evicted;
+}
+
+// the stats file is one line: hits, misses, evictions, entries and bytes
+bool ResultCache::read_totals(const char* buffer, Totals& totals) {
+	return sscanf(buffer, "%lld %lld %lld %lld %lld", &totals.hits, &totals.misses, &totals.evictions,
+	              &totals.entries, &totals.bytes) == 5;
+}
+
+void ResultCache::record_stats(const Totals& delta) {
+	std::error_code error;
+	fs::create_directories(directory, error);
+	int fd = open((directory + "/stats").c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0) { return; }
+	// other alc processes may update the totals (or evict) concurrently
+	flock(fd, LOCK_EX);
+	char buffer[256] = {};
+	Totals totals;
+	bool counted = pread(fd, buffer, sizeof(buffer) - 1, 0) > 0 && read_totals(buffer, totals);
+	totals.hits += delta.hits;
+	totals.misses += delta.misses;
+	totals.evictions += delta.evictions;
+	totals.entries += delta.entries;
+	totals.bytes += delta.bytes;
+	// a new stats file (or one without sizes) has not counted the entries yet
+	if (!counted || totals.bytes > (long long)maxBytes) {
+		evict(totals);
+	}
+	int size = snprintf(buffer, sizeof(buffer), "%lld %lld %lld %lld %lld\n", totals.hits, totals.misses,
+	                    totals.evictions, totals.entries, totals.bytes);
+	if (ftruncate(fd, 0) != 0 || pwrite(fd, buffer, size, 0) != size) {
+		// totals are best-effort
+	}
+	flock(fd, LOCK_UN);
+	close(fd);
+}
+
+void ResultCache::print_stats(std::ostream& os) {
+	Totals totals;
+	std::ifstream stats(directory + "/stats");
+	std::string line;
+	std::getline(stats, line);
+	read_totals(line.c_str(), totals);
+	os << "result cache: " << hits << " hits, " << misses << " misses, " << evictions << " evictions"
+	   << " (total " << totals.hits << " hits, " << totals.misses << " misses, " << totals.evictions << " evictions; "
+	   << totals.entries << " entries, " << totals.bytes << " bytes)" << std::endl;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include "Expr.h"
+
+// cache of program results (--result-cache)
+// AL programs have no inputs or effects, so a program's printed result only
+// depends on its type-checked AST; entries are keyed by a hash of the
+// normalized program and hold the normalized program too, so that a hash
+// collision is a miss; the least recently used entries are evicted once
+// the directory grows past maxBytes
+// the directory's stats file keeps running totals, including the number and
+// size of the entries, so only eviction lists the directory
+class ResultCache {
+public:
+	// directory holding entries; empty disables the cache
+	static std::string directory;
+	static uint64_t maxBytes;
+
+	// counters for this process
+	static std::atomic<long long> hits;
+	static std::atomic<long long> misses;
+	static std::atomic<long long> evictions;
+
+	// the printed AST (without whitespace and comments) and type, with float
+	// literals in hexadecimal so that they are exact
+	static std::string normalize(const Expr* ast, const Type* type);
+
+	static uint64_t key(const std::string& normalized);
+
+	// sets result to the printed result of the normalized program
+	static bool lookup(uint64_t key, const std::string& normalized, std::string& result);
+
+	static void insert(uint64_t key, const std::string& normalized, const std::string& result);
+
+	// one line of statistics: this process's counters, totals over every
+	// process using the directory, and the directory's current size
+	static void print_stats(std::ostream& os);
+
+private:
+	// totals over every process using the directory
+	struct Totals {
+		long long hits = 0;
+		long long misses = 0;
+		long long evictions = 0;
+		long long entries = 0;
+		long long bytes = 0;
+	};
+
+	static std::string path(uint64_t key);
+
+	// adds delta to the totals kept in the directory, and evicts if the
+	// entries no longer fit in maxBytes
+	static void record_stats(const Totals& delta);
+
+	// counts the entries in the directory into totals, then removes least
+	// recently used ones until they fit in maxBytes
+	static void evict(Totals& totals);
+
+	static bool read_totals(const char* buffer, Totals& totals);
+};
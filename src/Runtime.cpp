@@ -0,0 +1,93 @@
+#include <exception>
+#include "Runtime.h"
+#include "ThreadPool.h"
+#include "Expr.h"
+#include "MemoTable.h"
+#include "expr/EBinaryOp.h"
+#include "expr/EFix.h"
+#include "expr/EFunAp.h"
+#include "expr/EIf.h"
+#include "expr/ELet.h"
+#include "expr/EUnaryOp.h"
+
+ThreadPool* Runtime::pool = nullptr;
+int Runtime::forkDepthLimit = 0;
+
+static thread_local int forkDepth = 0;
+
+void Runtime::set_parallelism(int numThreads) {
+	delete pool;
+	pool = nullptr;
+	if (numThreads > 1) {
+		pool = new ThreadPool(numThreads);
+		// enough forks to keep every thread busy with some slack for imbalance
+		int log2 = 0;
+		while ((1 << log2) < numThreads) {
+			++log2;
+		}
+		forkDepthLimit = log2 + 6;
+	}
+}
+
+void Runtime::enable_memoization(Expr* ast) {
+	if (EFix* fix = dynamic_cast<EFix*>(ast)) {
+		std::unordered_set<std::string> vars;
+		fix->free_vars(vars);
+		if (vars.empty() && !fix->memo) {
+			fix->memo = new MemoTable();
+		}
+	}
+	ast->for_each_child([](Expr*& child) {
+		enable_memoization(child);
+	});
+}
+
+void Runtime::eval_operands(const Expr* left, const Expr* right, Value*& leftValue, Value*& rightValue) {
+	rightValue = nullptr;
+	if (!pool || forkDepth >= forkDepthLimit || !is_expensive(left) || !is_expensive(right)) {
+		leftValue = left->eval();
+		if (!leftValue) { return; }
+		rightValue = right->eval();
+		return;
+	}
+	int depth = forkDepth;
+	std::exception_ptr leftError;
+	ThreadPool::Task task([&]() {
+		// the task may run on another thread, or on this one while it waits
+		int savedDepth = forkDepth;
+		forkDepth = depth + 1;
+		try {
+			leftValue = left->eval();
+		} catch (...) {
+			leftError = std::current_exception();
+		}
+		forkDepth = savedDepth;
+	});
+	pool->spawn(&task);
+	forkDepth = depth + 1;
+	std::exception_ptr rightError;
+	try {
+		rightValue = right->eval();
+	} catch (...) {
+		rightError = std::current_exception();
+	}
+	forkDepth = depth;
+	pool->wait(&task);
+	if (leftError) { std::rethrow_exception(leftError); }
+	if (rightError) { std::rethrow_exception(rightError); }
+}
+
+bool Runtime::is_expensive(const Expr* expr) {
+	if (expr->as<EFunAp>()) {
+		return true;
+	} else if (const EBinaryOp* e = expr->as<EBinaryOp>()) {
+		return is_expensive(e->left) || is_expensive(e->right);
+	} else if (const EUnaryOp* e = expr->as<EUnaryOp>()) {
+		return is_expensive(e->right);
+	} else if (const EIf* e = expr->as<EIf>()) {
+		return is_expensive(e->test) || is_expensive(e->body) || is_expensive(e->elseBody);
+	} else if (const ELet* e = expr->as<ELet>()) {
+		return is_expensive(e->value) || is_expensive(e->body);
+	}
+	return false;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+class Expr;
+class Value;
+class ThreadPool;
+
+// process-wide evaluation settings, configured from the command line
+class Runtime {
+public:
+	// fork-join evaluation of independent operands (--parallel=N), also
+	// used to lex large sources in chunks; nullptr means evaluation is
+	// sequential
+	static ThreadPool* pool;
+
+	// forks nested deeper than this are evaluated sequentially, so small
+	// subtrees near the leaves of a divide-and-conquer recursion stay cheap
+	static int forkDepthLimit;
+
+	static void set_parallelism(int numThreads);
+
+	// attaches a results cache to every closed fix expression in ast (--memo)
+	// evaluation is pure, so a closed recursive function can be memoized
+	// on its argument without changing the program's result
+	static void enable_memoization(Expr* ast);
+
+	// evaluates left and then right; with a pool, left is forked as a task
+	// when both sides are estimated to be expensive
+	// on failure either value may be nullptr
+	static void eval_operands(const Expr* left, const Expr* right, Value*& leftValue, Value*& rightValue);
+
+	// cost estimate: true if evaluating expr applies a function
+	// (function bodies are values and not counted)
+	static bool is_expensive(const Expr* expr);
+};
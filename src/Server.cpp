@@ -0,0 +1,146 @@
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+#include "Server.h"
+#include "ThreadPool.h"
+
+namespace {
+
+bool read_exact(int fd, char* data, size_t size) {
+	while (size > 0) {
+		ssize_t n = read(fd, data, size);
+		if (n < 0 && errno == EINTR) { continue; }
+		if (n <= 0) { return false; }
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+bool write_exact(int fd, const char* data, size_t size) {
+	while (size > 0) {
+		ssize_t n = write(fd, data, size);
+		if (n < 0 && errno == EINTR) { continue; }
+		if (n <= 0) { return false; }
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+void put_u32(std::string& out, uint32_t value) {
+	for (int shift = 24; shift >= 0; shift -= 8) {
+		out.push_back((char)(value >> shift));
+	}
+}
+
+void put_u64(std::string& out, uint64_t value) {
+	put_u32(out, value >> 32);
+	put_u32(out, value);
+}
+
+void put_string(std::string& out, const std::string& str) {
+	put_u32(out, str.size());
+	out += str;
+}
+
+}
+
+int Server::serve(const std::string& path, int numThreads, const Handler& handler) {
+	// a client that disconnects early must not kill the server
+	signal(SIGPIPE, SIG_IGN);
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path)) {
+		std::cout << "Socket path too long: " << path << std::endl;
+		return 1;
+	}
+	strcpy(addr.sun_path, path.c_str());
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0) {
+		std::cout << "Failed to create socket: " << strerror(errno) << std::endl;
+		return 1;
+	}
+	unlink(path.c_str());
+	if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 64) != 0) {
+		std::cout << "Failed to listen on " << path << ": " << strerror(errno) << std::endl;
+		close(listener);
+		return 1;
+	}
+	std::cout << "listening on " << path << std::endl;
+
+	// this thread only accepts, so the pool gets one more thread than there are workers
+	ThreadPool pool(numThreads + 1);
+	std::vector<ThreadPool::Task*> connections;
+	while (true) {
+		int fd = accept(listener, nullptr, nullptr);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) { continue; }
+			std::cout << "Failed to accept connection: " << strerror(errno) << std::endl;
+			break;
+		}
+		// reclaim finished connections
+		auto done = std::remove_if(connections.begin(), connections.end(), [](ThreadPool::Task* task) {
+			if (!task->done.load(std::memory_order_acquire)) { return false; }
+			delete task;
+			return true;
+		});
+		connections.erase(done, connections.end());
+		connections.push_back(new ThreadPool::Task([fd, &handler]() {
+			serve_connection(fd, handler);
+			close(fd);
+		}));
+		pool.spawn(connections.back());
+	}
+	close(listener);
+	for (ThreadPool::Task* task : connections) {
+		pool.wait(task);
+	}
+	return 1;
+}
+
+void Server::serve_connection(int fd, const Handler& handler) {
+	while (true) {
+		unsigned char header[4];
+		if (!read_exact(fd, (char*)header, 4)) { return; }
+		uint32_t size = (uint32_t)header[0] << 24 | header[1] << 16 | header[2] << 8 | header[3];
+		if (size > maxRequestSize) { return; }
+		std::string program(size, '\0');
+		if (!read_exact(fd, &program[0], size)) { return; }
+
+		auto start = std::chrono::steady_clock::now();
+		// whatever the handler throws fails this request only; an uncaught
+		// exception would end the whole server
+		Response response;
+		try {
+			response = handler(program);
+		} catch (const std::exception& e) {
+			response = Response();
+			response.output = std::string("internal error: ") + e.what() + "\n";
+		} catch (...) {
+			response = Response();
+			response.output = "internal error\n";
+		}
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		response.micros = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+		std::string body;
+		put_u32(body, (uint32_t)response.status);
+		put_u64(body, response.micros);
+		put_string(body, response.value);
+		put_string(body, response.type);
+		put_string(body, response.output);
+		std::string frame;
+		put_u32(frame, body.size());
+		frame += body;
+		if (!write_exact(fd, frame.data(), frame.size())) { return; }
+	}
+}
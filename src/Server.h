@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <functional>
+
+// long-running compile server on a Unix domain socket (--serve)
+//
+// a client sends any number of requests on one connection and reads one
+// response per request; integers are big-endian, and a string is a u32
+// length followed by that many bytes
+//   request:  string program
+//   response: u32 length of the rest, i32 status, u64 elapsed microseconds,
+//             string value, string type, string output
+// value and type are set for programs that evaluated (or type-checked)
+// successfully; output holds everything alc would have printed, including
+// diagnostics, and is the only field set when status is nonzero
+// a request that fails (a runtime error such as division by zero included)
+// only gets a failed response; the connection and the server carry on
+class Server {
+public:
+	struct Response {
+		int status = 1;
+		uint64_t micros = 0;
+		std::string value;
+		std::string type;
+		std::string output;
+	};
+
+	using Handler = std::function<Response(const std::string& program)>;
+
+	// largest accepted request; larger ones close the connection
+	static const uint32_t maxRequestSize = 64 << 20;
+
+	// listens at path (replacing a stale socket file) and serves up to
+	// numThreads connections at a time; only returns on failure
+	static int serve(const std::string& path, int numThreads, const Handler& handler);
+
+private:
+	static void serve_connection(int fd, const Handler& handler);
+};
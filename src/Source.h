@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <mutex>
 #include <vector>
 #include <iomanip>
 #include <sstream>
@@ -22,6 +23,64 @@ private:
 	};
 
 public:
+	// while a thread uses an error buffer, the errors it reports are held
+	// there, and only reach their sources when the buffer is committed
+	// (parallel type checking drops the errors of subtrees the sequential
+	// checker would not have checked)
+	class ErrorBuffer {
+	public:
+		// uses a buffer on the calling thread until destroyed
+		class Scope {
+		public:
+			Scope(ErrorBuffer& buffer) : saved(current) {
+				current = &buffer;
+			}
+			~Scope() {
+				current = saved;
+			}
+
+		private:
+			ErrorBuffer* saved;
+		};
+
+		// reports the held errors on the calling thread (so to the buffer it
+		// uses, if any)
+		void commit() {
+			for (auto& [source, error] : errors) {
+				source->report_error(error.line, error.col, error.len, std::move(error.error));
+			}
+			errors.clear();
+		}
+
+		// writes the held errors as their sources would emit them, and drops
+		// them
+		void emit(std::ostream& os) {
+			while (!errors.empty()) {
+				const Source* source = errors.front().first;
+				std::vector<Error> sourceErrors;
+				auto rest = std::stable_partition(errors.begin(), errors.end(), [source](const auto& error) {
+					return error.first != source;
+				});
+				for (auto it = rest; it != errors.end(); ++it) {
+					sourceErrors.push_back(std::move(it->second));
+				}
+				errors.erase(rest, errors.end());
+				source->emit(os, sourceErrors);
+			}
+		}
+
+		bool empty() const {
+			return errors.empty();
+		}
+
+	private:
+		std::vector<std::pair<const Source*, Error>> errors;
+
+		static inline thread_local ErrorBuffer* current = nullptr;
+
+		friend struct Source;
+	};
+
 	std::vector<std::string> lines;
 
 	Source(std::istream& is, std::string filepath = "") : filepath(std::move(filepath)) {
@@ -38,11 +97,26 @@ public:
 		return !errors.empty();
 	}
 
+	// may be called concurrently (e.g. from parallel evaluation)
 	void report_error(int line, int col, int len, std::string error) const {
+		if (ErrorBuffer::current) {
+			ErrorBuffer::current->errors.push_back({ this, { line, col, len, std::move(error) } });
+			return;
+		}
+		std::lock_guard<std::mutex> lock(errorsMutex);
 		errors.push_back({line, col, len, std::move(error)});
 	}
 
 	void emit_errors(std::ostream& os) const {
+		emit(os, errors);
+	}
+
+private:
+	mutable std::vector<Error> errors;
+	mutable std::mutex errorsMutex;
+	std::string filepath;
+
+	void emit(std::ostream& os, std::vector<Error>& errors) const {
 		// sort errors
 		std::sort(errors.begin(), errors.end(), [](const Error& a, const Error& b) -> bool {
 			if (a.line == b.line) {
@@ -85,10 +159,6 @@ public:
 		}
 	}
 
-private:
-	mutable std::vector<Error> errors;
-	std::string filepath;
-
 	static std::string left_pad(const std::string& str, int len, char pad = ' ') {
 		return std::string(std::max(0, len - (int)str.size()), pad) + str;
 	}
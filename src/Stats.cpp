@@ -0,0 +1,54 @@
+#include <algorithm>
+#include "Stats.h"
+
+bool Stats::enabled = false;
+std::atomic<long long> Stats::tokens{ 0 };
+std::atomic<long long> Stats::astNodes{ 0 };
+std::atomic<long long> Stats::types{ 0 };
+std::atomic<long long> Stats::substCalls{ 0 };
+std::atomic<long long> Stats::copies{ 0 };
+std::atomic<long long> Stats::values{ 0 };
+std::atomic<long long> Stats::opLookups{ 0 };
+
+std::vector<std::pair<std::string, long long>> Stats::counters() {
+	return {
+		{ "tokens", tokens },
+		{ "ast_nodes", astNodes },
+		{ "types", types },
+		{ "subst_calls", substCalls },
+		{ "copies", copies },
+		{ "values", values },
+		{ "op_lookups", opLookups },
+	};
+}
+
+void Stats::print(std::ostream& os, const Phases& phases,
+                  const std::vector<std::pair<std::string, long long>>& start, bool json) {
+	std::vector<std::pair<std::string, long long>> end = counters();
+	double total = 0;
+	for (const auto& [phase, ms] : phases) {
+		total += ms;
+	}
+	if (json) {
+		os << "{\"phases_ms\": {";
+		for (size_t i = 0; i < phases.size(); ++i) {
+			os << (i ? ", " : "") << "\"" << phases[i].first << "\": " << phases[i].second;
+		}
+		os << "}, \"total_ms\": " << total << ", \"counters\": {";
+		for (size_t i = 0; i < end.size(); ++i) {
+			os << (i ? ", " : "") << "\"" << end[i].first << "\": " << end[i].second - start[i].second;
+		}
+		os << "}}" << std::endl;
+		return;
+	}
+	os << "stats:" << std::endl;
+	for (const auto& [phase, ms] : phases) {
+		os << "  " << phase << std::string(12 - std::min<size_t>(phase.size(), 11), ' ') << ms << " ms" << std::endl;
+	}
+	os << "  total       " << total << " ms" << std::endl;
+	for (size_t i = 0; i < end.size(); ++i) {
+		const std::string& name = end[i].first;
+		os << "  " << name << std::string(12 - std::min<size_t>(name.size(), 11), ' ')
+		   << end[i].second - start[i].second << std::endl;
+	}
+}
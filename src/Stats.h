@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <utility>
+#include <iostream>
+
+// counters and phase timings reported by --stats
+// counters are process-wide, so runs must not overlap (batch and serve
+// modes only allow --stats with -j 1)
+class Stats {
+public:
+	// counters only move while enabled
+	static bool enabled;
+
+	static std::atomic<long long> tokens;
+	static std::atomic<long long> astNodes;
+	static std::atomic<long long> types;
+	static std::atomic<long long> substCalls;
+	static std::atomic<long long> copies;
+	static std::atomic<long long> values;
+	static std::atomic<long long> opLookups;
+
+	static void count(std::atomic<long long>& counter, long long n = 1) {
+		if (enabled) {
+			counter.fetch_add(n, std::memory_order_relaxed);
+		}
+	}
+
+	// values of every counter, in print order
+	static std::vector<std::pair<std::string, long long>> counters();
+
+	// wall time of each phase of one run, in milliseconds and in run order
+	using Phases = std::vector<std::pair<std::string, double>>;
+
+	// prints phases and the counters' growth since start (from counters())
+	static void print(std::ostream& os, const Phases& phases,
+	                  const std::vector<std::pair<std::string, long long>>& start, bool json);
+};
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include "ThreadPool.h"
+
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local int currentIndex = 0;
+
+ThreadPool::ThreadPool(int numThreads) : queues(std::max(1, numThreads)) {
+	for (int i = 1; i < size(); ++i) {
+		threads.emplace_back([this, i]() {
+			worker_loop(i);
+		});
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	sleepCv.notify_all();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+void ThreadPool::spawn(Task* task) {
+	Queue& queue = queues[current_index()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(task);
+	}
+	++pending;
+	if (!threads.empty()) {
+		// taking the lock orders this wakeup after a sleeper's predicate check
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		sleepCv.notify_one();
+	}
+}
+
+void ThreadPool::wait(Task* task) {
+	int index = current_index();
+	while (!task->done.load(std::memory_order_acquire)) {
+		Task* other = find_task(index);
+		if (other) {
+			run_task(other);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void ThreadPool::worker_loop(int index) {
+	currentPool = this;
+	currentIndex = index;
+	while (true) {
+		Task* task = find_task(index);
+		if (task) {
+			run_task(task);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCv.wait(lock, [this]() {
+			return stopping || pending > 0;
+		});
+		if (stopping) { return; }
+	}
+}
+
+ThreadPool::Task* ThreadPool::find_task(int index) {
+	// own queue first (newest job, best locality)
+	{
+		Queue& queue = queues[index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			Task* task = queue.tasks.back();
+			queue.tasks.pop_back();
+			--pending;
+			return task;
+		}
+	}
+	// steal oldest job (likely the largest) from another queue
+	for (int i = 1; i < size(); ++i) {
+		Queue& queue = queues[(index + i) % size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			Task* task = queue.tasks.front();
+			queue.tasks.pop_front();
+			--pending;
+			return task;
+		}
+	}
+	return nullptr;
+}
+
+void ThreadPool::run_task(Task* task) {
+	task->job();
+	task->done.store(true, std::memory_order_release);
+}
+
+int ThreadPool::current_index() const {
+	return currentPool == this ? currentIndex : 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+// work-stealing thread pool
+// each worker owns a deque: it pushes and pops its own jobs at the back (LIFO)
+// and steals from the front of other workers' deques (FIFO) when idle
+class ThreadPool {
+public:
+	// a unit of work; spawn() it, then wait() on it to join
+	struct Task {
+		std::function<void()> job;
+		std::atomic<bool> done{ false };
+
+		Task(std::function<void()> job) : job(std::move(job)) {}
+	};
+
+	// numThreads counts the calling thread, which takes part in the work
+	// whenever it waits on a task (so numThreads - 1 threads are started)
+	ThreadPool(int numThreads);
+	~ThreadPool();
+
+	int size() const {
+		return (int)queues.size();
+	}
+
+	void spawn(Task* task);
+
+	// blocks until task is done, running other jobs in the meantime
+	void wait(Task* task);
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task*> tasks;
+	};
+
+	std::vector<Queue> queues;
+	std::vector<std::thread> threads;
+
+	// idle workers sleep until a job is queued
+	std::mutex sleepMutex;
+	std::condition_variable sleepCv;
+	std::atomic<int> pending{ 0 };
+	bool stopping = false;
+
+	void worker_loop(int index);
+
+	// returns nullptr if no work could be found
+	Task* find_task(int index);
+
+	static void run_task(Task* task);
+
+	// index into queues for the current thread; threads outside this
+	// pool use queue 0 (shared with the thread that created the pool)
+	int current_index() const;
+};
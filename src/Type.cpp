@@ -20,7 +20,224 @@ const Type* Type::Unit() {
 	return type;
 }
 
+// the variable and type of the last failed occurs check, for unify_error
+static thread_local const TVar* infiniteVar = nullptr;
+static thread_local const Type* infiniteType = nullptr;
+
+// names of unbound variables within the type currently being printed,
+// so every printed type reads 'a, 'b, ... regardless of variable ids
+static thread_local std::unordered_map<const TVar*, int>* printNames = nullptr;
+
+std::atomic<int> TVar::nextId{ 0 };
+thread_local int TVar::currentLevel = 0;
+
+const TVar* TVar::fresh() {
+	return new TVar(nextId++, currentLevel);
+}
+
+const Type* Type::resolve(const Type* type) {
+	const TVar* var = dynamic_cast<const TVar*>(type);
+	if (!var || !var->instance) { return type; }
+	const Type* root = resolve(var->instance);
+	// compressed paths are not written again, so types shared by parallel
+	// type checking tasks are only read
+	if (var->instance != root) {
+		var->instance = root;
+	}
+	return root;
+}
+
+// occurs check; also lowers the level of variables in type to var's level,
+// so they are not generalized while var is still visible in an outer scope
+static bool occurs(const TVar* var, const Type* type) {
+	type = Type::resolve(type);
+	if (const TVar* other = dynamic_cast<const TVar*>(type)) {
+		if (other == var) { return true; }
+		other->level = std::min(other->level, var->level);
+		return false;
+	}
+	if (const TArrow* arrow = dynamic_cast<const TArrow*>(type)) {
+		return occurs(var, arrow->left) || occurs(var, arrow->right);
+	}
+	if (const TTuple* tuple = dynamic_cast<const TTuple*>(type)) {
+		for (const Type* element : tuple->types) {
+			if (occurs(var, element)) { return true; }
+		}
+	}
+	return false;
+}
+
+bool Type::unify(const Type* a, const Type* b) {
+	infiniteVar = nullptr;
+	a = resolve(a);
+	b = resolve(b);
+	if (a == b) { return true; }
+	const TVar* aVar = dynamic_cast<const TVar*>(a);
+	const TVar* bVar = dynamic_cast<const TVar*>(b);
+	if (aVar || bVar) {
+		const TVar* var = aVar ? aVar : bVar;
+		const Type* type = aVar ? b : a;
+		if (occurs(var, type)) {
+			infiniteVar = var;
+			infiniteType = type;
+			return false;
+		}
+		if (!var->operandTypes.empty()) {
+			// an operand stays an operand
+			if (const TVar* other = dynamic_cast<const TVar*>(type)) {
+				if (!restrict(other, var->operandTypes)) { return false; }
+			} else if (std::none_of(var->operandTypes.begin(), var->operandTypes.end(), [type](const Type* operandType) {
+				return operandType->equal(type);
+			})) {
+				return false;
+			}
+		}
+		var->instance = type;
+		return true;
+	}
+	const TArrow* aArrow = dynamic_cast<const TArrow*>(a);
+	const TArrow* bArrow = dynamic_cast<const TArrow*>(b);
+	if (aArrow || bArrow) {
+		return aArrow && bArrow && unify(aArrow->left, bArrow->left) && unify(aArrow->right, bArrow->right);
+	}
+	const TTuple* aTuple = dynamic_cast<const TTuple*>(a);
+	const TTuple* bTuple = dynamic_cast<const TTuple*>(b);
+	if (aTuple || bTuple) {
+		if (!aTuple || !bTuple || aTuple->types.size() != bTuple->types.size()) { return false; }
+		for (size_t i = 0; i < aTuple->types.size(); ++i) {
+			if (!unify(aTuple->types[i], bTuple->types[i])) { return false; }
+		}
+		return true;
+	}
+	return a->equal(b);
+}
+
+std::string Type::unify_error(const std::string& mismatch) {
+	if (!infiniteVar) { return mismatch; }
+	// one printing scope, so the variable reads the same in both
+	std::unordered_map<const TVar*, int> names;
+	printNames = &names;
+	std::ostringstream oss;
+	oss << "infinite type: ";
+	infiniteVar->print(oss);
+	oss << " occurs in ";
+	infiniteType->print(oss);
+	printNames = nullptr;
+	return oss.str();
+}
+
+const Type* Type::generalize(const Type* type) {
+	const Type* resolved = resolve(type);
+	if (const TVar* var = dynamic_cast<const TVar*>(resolved)) {
+		// an operand's type may still be decided by a use of the binding (as
+		// in 'let add = fun a -> fun b -> a + b in add 1.5 2.5'), so it is
+		// not generalized
+		if (var->operandTypes.empty() && var->level > TVar::currentLevel && var->level != TVar::genericLevel) {
+			var->level = TVar::genericLevel;
+		}
+	} else if (const TArrow* arrow = dynamic_cast<const TArrow*>(resolved)) {
+		generalize(arrow->left);
+		generalize(arrow->right);
+	} else if (const TTuple* tuple = dynamic_cast<const TTuple*>(resolved)) {
+		for (const Type* element : tuple->types) {
+			generalize(element);
+		}
+	}
+	return type;
+}
+
+bool Type::restrict(const TVar* var, const std::vector<const Type*>& types) {
+	std::vector<const Type*> allowed;
+	for (const Type* type : var->operandTypes.empty() ? types : var->operandTypes) {
+		if (std::any_of(types.begin(), types.end(), [type](const Type* other) { return other->equal(type); })) {
+			allowed.push_back(type);
+		}
+	}
+	if (allowed.empty()) { return false; }
+	var->operandTypes = std::move(allowed);
+	return true;
+}
+
+void Type::default_operands(const Type* type) {
+	type = resolve(type);
+	if (const TVar* var = dynamic_cast<const TVar*>(type)) {
+		if (!var->operandTypes.empty()) {
+			var->instance = var->operandTypes.front();
+		}
+	} else if (const TArrow* arrow = dynamic_cast<const TArrow*>(type)) {
+		default_operands(arrow->left);
+		default_operands(arrow->right);
+	} else if (const TTuple* tuple = dynamic_cast<const TTuple*>(type)) {
+		for (const Type* element : tuple->types) {
+			default_operands(element);
+		}
+	}
+}
+
+static const Type* instantiate(const Type* type, std::unordered_map<const TVar*, const Type*>& fresh) {
+	type = Type::resolve(type);
+	if (const TVar* var = dynamic_cast<const TVar*>(type)) {
+		if (var->level != TVar::genericLevel) { return type; }
+		const Type*& instance = fresh[var];
+		if (!instance) {
+			instance = TVar::fresh();
+		}
+		return instance;
+	}
+	if (const TArrow* arrow = dynamic_cast<const TArrow*>(type)) {
+		const Type* left = instantiate(arrow->left, fresh);
+		const Type* right = instantiate(arrow->right, fresh);
+		if (left == arrow->left && right == arrow->right) { return type; }
+		return new TArrow(left, right);
+	}
+	if (const TTuple* tuple = dynamic_cast<const TTuple*>(type)) {
+		std::vector<const Type*> types;
+		bool changed = false;
+		for (const Type* element : tuple->types) {
+			types.push_back(instantiate(element, fresh));
+			changed = changed || types.back() != element;
+		}
+		if (!changed) { return type; }
+		return new TTuple(std::move(types));
+	}
+	return type;
+}
+
+const Type* Type::instantiate(const Type* type) {
+	std::unordered_map<const TVar*, const Type*> fresh;
+	return ::instantiate(type, fresh);
+}
+
+void TVar::print(std::ostream& os) const {
+	const Type* self = resolve(this);
+	if (self != this) {
+		self->print(os);
+		return;
+	}
+	if (!printNames) {
+		os << "'t" << id;
+		return;
+	}
+	auto it = printNames->emplace(this, (int)printNames->size()).first;
+	os << "'" << (char)('a' + it->second % 26);
+	if (it->second >= 26) {
+		os << it->second / 26;
+	}
+}
+
 std::ostream& operator<<(std::ostream& os, const Type* type) {
-	type->print(os);
+	if (printNames) {
+		type->print(os);
+		return os;
+	}
+	std::unordered_map<const TVar*, int> names;
+	printNames = &names;
+	try {
+		type->print(os);
+	} catch (...) {
+		printNames = nullptr;
+		throw;
+	}
+	printNames = nullptr;
 	return os;
 }
@@ -1,14 +1,20 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <sstream>
 #include <algorithm>
 #include <unordered_map>
+#include "Stats.h"
+
+class TVar;
 
 class Type {
 public:
-	Type() {}
+	Type() {
+		Stats::count(Stats::types);
+	}
 	virtual ~Type() {}
 
 	virtual bool equal(const Type* other) const = 0;
@@ -19,12 +25,76 @@ public:
 	static const Type* Bool();
 	static const Type* Unit();
 
+	// Hindley-Milner inference (union-find over TVar, level-based generalization)
+	// follows bound type variables to their representative, compressing paths
+	static const Type* resolve(const Type* type);
+	// binds type variables so that a and b become equal; false if they clash
+	static bool unify(const Type* a, const Type* b);
+	// message for the last failed unify on this thread: mismatch, unless it
+	// failed on the occurs check (fun x -> x x), which names the infinite type
+	static std::string unify_error(const std::string& mismatch);
+	// marks variables created inside the current let-binding as generic (in
+	// place); operand variables (see restrict) stay monomorphic
+	static const Type* generalize(const Type* type);
+	// restricts an operator operand of unknown type to the types that define
+	// the operator; false if that leaves none
+	static bool restrict(const TVar* var, const std::vector<const Type*>& types);
+	// binds the operand variables left in a top-level type to their default
+	// (the first type they are restricted to), once nothing else can decide them
+	static void default_operands(const Type* type);
+	// replaces generic variables by fresh ones; returns type itself if it has none
+	static const Type* instantiate(const Type* type);
+
+	// casts see through bound type variables
 	template <typename T>
 	const T* as() const {
-		return dynamic_cast<const T*>(this);
+		return dynamic_cast<const T*>(resolve(this));
 	}
 };
 
+// type variable; unbound until unification gives it an instance
+class TVar : public Type {
+public:
+	// level of the innermost let-binding whose value created this variable;
+	// variables at genericLevel are quantified
+	static const int genericLevel = 1 << 30;
+
+	int id;
+	mutable int level;
+	mutable const Type* instance = nullptr;
+	// types an operator operand may still take, most preferred first; empty
+	// for variables that are not operands
+	mutable std::vector<const Type*> operandTypes;
+
+	TVar(int id, int level) : id(id), level(level) {}
+
+	// fresh variable at the current let level
+	static const TVar* fresh();
+
+	// let-bound values are checked one level deeper than their scope
+	static void enter_level() { ++currentLevel; }
+	static void leave_level() { --currentLevel; }
+
+	// the level is per thread; a task checking a subtree on another thread
+	// starts at the level of the thread that forked it
+	static int current_level() { return currentLevel; }
+	static void set_current_level(int level) { currentLevel = level; }
+
+	bool equal(const Type* other) const override {
+		const Type* self = resolve(this);
+		if (self != this) { return self->equal(other); }
+		return resolve(other) == this;
+	}
+
+	void print(std::ostream& os) const override;
+
+private:
+	static std::atomic<int> nextId;
+	static thread_local int currentLevel;
+
+	friend class Type;
+};
+
 class TBase : public Type {
 public:
 	std::string name;
@@ -56,7 +126,14 @@ public:
 	}
 
 	void print(std::ostream& os) const override {
-		left->print(os);
+		// arrows associate to the right, so only a function argument needs parens
+		if (left->as<TArrow>()) {
+			os << "(";
+			left->print(os);
+			os << ")";
+		} else {
+			left->print(os);
+		}
 		os << " -> ";
 		right->print(os);
 	}
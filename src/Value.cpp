@@ -1,5 +1,14 @@
 #include "Value.h"
 
+__attribute__((noinline)) void* Value::operator new(size_t size) {
+	HeapProfiler::record(size);
+	return ::operator new(size);
+}
+
+__attribute__((noinline)) void Value::operator delete(void* p) {
+	::operator delete(p);
+}
+
 std::ostream& operator<<(std::ostream& os, const Value* value) {
 	value->print(os);
 	return os;
@@ -3,11 +3,21 @@
 #include <sstream>
 #include <optional>
 #include "Type.h"
+#include "Stats.h"
+#include "HeapProfiler.h"
 
 class Value {
 public:
-	Value() {}
+	Value() {
+		Stats::count(Stats::values);
+	}
 	virtual ~Value() {}
+
+	// charges the value to the current site (--heap-profile); out of line,
+	// as for Expr
+	static void* operator new(size_t size);
+	static void operator delete(void* p);
+
 	virtual void print(std::ostream& os) const = 0;
 	virtual const Type* get_type() const = 0;
 
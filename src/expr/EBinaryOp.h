@@ -3,6 +3,8 @@
 #include <sstream>
 #include "../Expr.h"
 #include "../Type.h"
+#include "../Runtime.h"
+#include "../ParallelChecker.h"
 #include "../OpDefinition.h"
 #include "../value/VBool.h"
 
@@ -16,48 +18,87 @@ public:
 		: Expr(loc, typeAnn), left(left), op(op), right(right) {}
 
 	Expr* copy() const override {
-		return new EBinaryOp(loc, typeAnn, left->copy(), op, right->copy());
+		Stats::count(Stats::copies);
+		return with_type(new EBinaryOp(loc, typeAnn, left->copy(), op, right->copy()));
 	}
 
 	Expr* subst(const std::string& subIdent, const Expr* subExpr) const override {
+		Stats::count(Stats::substCalls);
 		Expr* newLeft = left->subst(subIdent, subExpr);
 		Expr* newRight = right->subst(subIdent, subExpr);
-		return new EBinaryOp(loc, typeAnn, newLeft, op, newRight);
+		return with_type(new EBinaryOp(loc, typeAnn, newLeft, op, newRight));
 	}
 
 	Value* eval() const override {
-		Value* leftValue = left->eval();
-		if (!leftValue) { return nullptr; }
-		Value* rightValue = right->eval();
-		if (!rightValue) { return nullptr; }
-		Value* result = OpDefinition::binary_op_result(leftValue, op.type, rightValue);
+		HeapProfiler::Scope site(this, "op");
+		// operands are independent, so they may be evaluated in parallel
+		Value* leftValue;
+		Value* rightValue;
+		Runtime::eval_operands(left, right, leftValue, rightValue);
+		if (!leftValue || !rightValue) { return nullptr; }
+		Value* result;
+		try {
+			result = OpDefinition::binary_op_result(leftValue, op.type, rightValue);
+		} catch (const std::runtime_error& e) {
+			// division by zero, the only operator failure: an error in the
+			// program, reported like an unbound variable, so a batch or server
+			// run only fails this program
+			right->report_error_at_expr(e.what());
+			return nullptr;
+		}
 		if (!result) {
 			throw std::runtime_error("Attempted to evaluate ill-typed binary operation");
 		}
 		return result;
 	}
 
-	const Type* type_syn(const Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+	const Type* type_syn(Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+		if (synType) { return synType; }
 		// potential improvement: use (weaker) type analysis instead of synthesis?
-		const Type* ltype = left->type_syn(typeCtx);
-		if (!ltype) { return nullptr; }
-		const Type* rtype = right->type_syn(typeCtx);
-		if (!rtype) { return nullptr; }
-		const Type* result = OpDefinition::binary_op_type(ltype, op.type, rtype);
+		const Type* ltype = nullptr;
+		const Type* rtype = nullptr;
+		bool ok = ParallelChecker::check_both(left, right, typeCtx, [&](Context<const Type*>& ctx) {
+			return (ltype = left->type_syn(ctx)) != nullptr;
+		}, [&](Context<const Type*>& ctx) {
+			return (rtype = right->type_syn(ctx)) != nullptr;
+		});
+		if (!ok) { return nullptr; }
+		// every operator takes two operands of the same type; one that is
+		// still unknown is decided later, or defaults once the program's type is
+		// (see Type::default_operands)
+		bool unified = !ltype->as<TVar>() && !rtype->as<TVar>() || Type::unify(ltype, rtype);
+		ltype = Type::resolve(ltype);
+		rtype = Type::resolve(rtype);
+		const Type* result = nullptr;
+		if (unified) {
+			const TVar* var = ltype->as<TVar>();
+			result = var ? OpDefinition::open_binary_op_type(var, op.type) : OpDefinition::binary_op_type(ltype, op.type, rtype);
+		}
 		if (!result) {
 			if (reportErrors) {
 				std::ostringstream oss;
 				oss << "left expression (of " << ltype << " type) does not define operation "
 				    << op << " with right expression (of " << rtype << " type)";
-				left->report_error_at_expr(oss.str());
+				left->report_error_at_expr(unified ? oss.str() : Type::unify_error(oss.str()));
 			}
 			return nullptr;
 		}
-		return result;
+		return synType = result;
+	}
+
+	bool type_ana(const Type* type, Context<const Type*>& typeCtx) const override {
+		const Type* synthesized = type_syn(typeCtx);
+		return synthesized && Type::unify(synthesized, type);
+	}
+
+	void free_vars(std::unordered_set<std::string>& vars) const override {
+		left->free_vars(vars);
+		right->free_vars(vars);
 	}
 
-	bool type_ana(const Type* type, const Context<const Type*>& typeCtx) const override {
-		return type_syn(typeCtx, false) == type;
+	void for_each_child(const std::function<void(Expr*&)>& fun) override {
+		fun(left);
+		fun(right);
 	}
 
 	void print_impl(std::ostream& os) const override {
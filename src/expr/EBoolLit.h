@@ -11,10 +11,12 @@ public:
 		: Expr(loc, typeAnn), value(value) {}
 
 	Expr* copy() const override {
-		return new EBoolLit(loc, typeAnn, value);
+		Stats::count(Stats::copies);
+		return with_type(new EBoolLit(loc, typeAnn, value));
 	}
 
 	Expr* subst(const std::string& subIdent, const Expr* subExpr) const override {
+		Stats::count(Stats::substCalls);
 		return copy();
 	}
 
@@ -22,14 +24,19 @@ public:
 		return new VBool(value);
 	}
 
-	const Type* type_syn(const Context<const Type*>& typeCtx, bool reportErrors = true) const override {
-		return Type::Bool();
+	const Type* type_syn(Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+		return synType = Type::Bool();
 	}
 
-	bool type_ana(const Type* type, const Context<const Type*>& typeCtx) const override {
-		return type_syn(typeCtx, false) == type;
+	bool type_ana(const Type* type, Context<const Type*>& typeCtx) const override {
+		const Type* synthesized = type_syn(typeCtx);
+		return synthesized && Type::unify(synthesized, type);
 	}
 
+	void free_vars(std::unordered_set<std::string>& vars) const override {}
+
+	void for_each_child(const std::function<void(Expr*&)>& fun) override {}
+
 	void print_impl(std::ostream& os) const override {
 		os << (value ? "true" : "false");
 	}
@@ -2,51 +2,90 @@
 
 #include "../Expr.h"
 #include "EVar.h"
+#include "../MemoTable.h"
+#include "../value/VFun.h"
 
 class EFix : public Expr {
 public:
 	EVar* ident;
 	Expr* body;
+	// set on closed fix expressions when memoizing (see Runtime::enable_memoization);
+	// shared by every copy, since copies denote the same function
+	MemoTable* memo = nullptr;
 
 	EFix(const Location& loc, const Type* typeAnn, EVar* ident, Expr* body)
 		: Expr(loc, typeAnn), ident(ident), body(body) {}
 
 	Expr* copy() const override {
-		return new EFix(loc, typeAnn, ident, body->copy());
+		Stats::count(Stats::copies);
+		EFix* result = new EFix(loc, typeAnn, ident, body->copy());
+		result->memo = memo;
+		return with_type(result);
 	}
 
 	Expr* subst(const std::string& subIdent, const Expr* subExpr) const override {
+		Stats::count(Stats::substCalls);
+		if (memo) {
+			// memoized fix expressions are closed, so substitution is a no-op
+			return copy();
+		}
 		Expr* newBody;
 		if (subIdent != ident->value) {
 			newBody = body->subst(subIdent, subExpr);
 		} else {
 			newBody = body->copy();
 		}
-		return new EFix(loc, typeAnn, ident, newBody);
+		return with_type(new EFix(loc, typeAnn, ident, newBody));
 	}
 
 	Value* eval() const override {
+		HeapProfiler::Scope site(this, "fix");
 		// evaluation currently uses substitution (quite expensive)
-		return body->subst(ident->value, this)->eval();
+		Value* result = body->subst(ident->value, this)->eval();
+		if (memo && result) {
+			if (VFun* funValue = dynamic_cast<VFun*>(result)) {
+				funValue->memo = memo;
+			}
+		}
+		return result;
 	}
 
-	const Type* type_syn(const Context<const Type*>& typeCtx, bool reportErrors = true) const override {
-		if (ident->typeAnn) {
-			Context<const Type*> ctx = typeCtx;
-			ctx.push(ident->value, ident->typeAnn);
-			if (body->type_ana(ident->typeAnn, ctx)) {
-				return ident->typeAnn;
-			}
+	const Type* type_syn(Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+		if (synType) { return synType; }
+		// recursive uses are monomorphic; an unannotated fix infers its type
+		const Type* type = ident->typeAnn ? ident->typeAnn : TVar::fresh();
+		typeCtx.push(ident->value, type);
+		bool ok = body->type_ana(type, typeCtx);
+		typeCtx.pop(ident->value);
+		if (ok) {
+			return synType = type;
 		}
-		report_error_at_expr("ill-typed fix expression");
+		report_error_at_expr(Type::unify_error("ill-typed fix expression"));
 		return nullptr;
 	}
 
-	bool type_ana(const Type* type, const Context<const Type*>& typeCtx) const override {
-		if (type_syn(typeCtx, false) == type) { return true; }
-		Context<const Type*> ctx = typeCtx;
-		ctx.push(ident->value, type);
-		return body->type_ana(type, ctx);
+	bool type_ana(const Type* type, Context<const Type*>& typeCtx) const override {
+		// analyze the body directly (synthesizing first would check it twice)
+		if (ident->typeAnn && !Type::unify(ident->typeAnn, type)) { return false; }
+		typeCtx.push(ident->value, type);
+		bool ok = body->type_ana(type, typeCtx);
+		typeCtx.pop(ident->value);
+		if (!ok) {
+			return false;
+		}
+		synType = type;
+		return true;
+	}
+
+	void free_vars(std::unordered_set<std::string>& vars) const override {
+		std::unordered_set<std::string> bodyVars;
+		body->free_vars(bodyVars);
+		bodyVars.erase(ident->value);
+		vars.insert(bodyVars.begin(), bodyVars.end());
+	}
+
+	void for_each_child(const std::function<void(Expr*&)>& fun) override {
+		fun(body);
 	}
 
 	void print_impl(std::ostream& os) const override {
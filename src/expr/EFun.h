@@ -13,45 +13,64 @@ public:
 		: Expr(loc, typeAnn), ident(ident), body(body) {}
 
 	Expr* copy() const override {
-		return new EFun(loc, typeAnn, ident, body->copy());
+		Stats::count(Stats::copies);
+		return with_type(new EFun(loc, typeAnn, ident, body->copy()));
 	}
 
 	Expr* subst(const std::string& subIdent, const Expr* subExpr) const override {
+		Stats::count(Stats::substCalls);
 		Expr* newBody;
 		if (subIdent != ident->value) {
 			newBody = body->subst(subIdent, subExpr);
 		} else {
 			newBody = body->copy();
 		}
-		return new EFun(loc, typeAnn, ident, newBody);
+		return with_type(new EFun(loc, typeAnn, ident, newBody));
 	}
 
 	Value* eval() const override {
 		return new VFun(this);
 	}
 
-	const Type* type_syn(const Context<const Type*>& typeCtx, bool reportErrors = true) const override {
-		const Type* argType = ident->typeAnn;
-		if (!argType) {
-			if (reportErrors) {
-				// TODO: when implementing generics, have more clever type inference systems..
-				// ex. fun x -> x should synthesize as 'a -> 'a
-				report_error_at_expr("type annotation is necessary to make function well-typed");
-			}
-			return nullptr;
-		}
-		Context<const Type*> ctx = typeCtx;
-		ctx.push(ident->value, argType);
-		return new TArrow(argType, body->type_syn(ctx));
+	const Type* type_syn(Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+		if (synType) { return synType; }
+		// unannotated parameters are inferred (fun x -> x synthesizes 'a -> 'a)
+		const Type* argType = ident->typeAnn ? ident->typeAnn : TVar::fresh();
+		typeCtx.push(ident->value, argType);
+		const Type* bodyType = body->type_syn(typeCtx);
+		typeCtx.pop(ident->value);
+		if (!bodyType) { return nullptr; }
+		return synType = new TArrow(argType, bodyType);
 	}
 
-	bool type_ana(const Type* type, const Context<const Type*>& typeCtx) const override {
-		if (type_syn(typeCtx, false) == type) { return true; }
+	bool type_ana(const Type* type, Context<const Type*>& typeCtx) const override {
+		// analyze the body directly (synthesizing first would check it twice)
 		const TArrow* arrowType = type->as<TArrow>();
-		if (!arrowType) { return false; }
-		Context<const Type*> ctx = typeCtx;
-		ctx.push(ident->value, arrowType->left);
-		return body->type_ana(arrowType->right, ctx);
+		if (!arrowType) {
+			// type is not known to be an arrow yet (e.g. a type variable)
+			const Type* synthesized = type_syn(typeCtx);
+			return synthesized && Type::unify(synthesized, type);
+		}
+		if (ident->typeAnn && !Type::unify(ident->typeAnn, arrowType->left)) { return false; }
+		typeCtx.push(ident->value, arrowType->left);
+		bool ok = body->type_ana(arrowType->right, typeCtx);
+		typeCtx.pop(ident->value);
+		if (!ok) {
+			return false;
+		}
+		synType = type;
+		return true;
+	}
+
+	void free_vars(std::unordered_set<std::string>& vars) const override {
+		std::unordered_set<std::string> bodyVars;
+		body->free_vars(bodyVars);
+		bodyVars.erase(ident->value);
+		vars.insert(bodyVars.begin(), bodyVars.end());
+	}
+
+	void for_each_child(const std::function<void(Expr*&)>& fun) override {
+		fun(body);
 	}
 
 	void print_impl(std::ostream& os) const override {
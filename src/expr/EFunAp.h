@@ -2,6 +2,8 @@
 
 #include "../Expr.h"
 #include "EFun.h"
+#include "../MemoTable.h"
+#include "../Profiler.h"
 
 class EFunAp : public Expr {
 public:
@@ -12,16 +14,19 @@ public:
 		: Expr(loc, typeAnn), fun(fun), arg(arg) {}
 
 	Expr* copy() const override {
-		return new EFunAp(loc, typeAnn, fun->copy(), arg->copy());
+		Stats::count(Stats::copies);
+		return with_type(new EFunAp(loc, typeAnn, fun->copy(), arg->copy()));
 	}
 
 	Expr* subst(const std::string& subIdent, const Expr* subExpr) const override {
+		Stats::count(Stats::substCalls);
 		Expr* newFun = fun->subst(subIdent, subExpr);
 		Expr* newArg = arg->subst(subIdent, subExpr);
-		return new EFunAp(loc, typeAnn, newFun, newArg);
+		return with_type(new EFunAp(loc, typeAnn, newFun, newArg));
 	}
 
 	Value* eval() const override {
+		HeapProfiler::Scope site(this, "apply");
 		Value* left = fun->eval();
 		if (!left) { return nullptr; }
 		const VFun* funValue = left->as<VFun>();
@@ -34,13 +39,30 @@ public:
 		}
 		Value* right = arg->eval();
 		if (!right) { return nullptr; }
-		return funExpr->body->subst(funExpr->ident->value, arg)->eval();
+		Value* result;
+		if (funValue->memo && funValue->memo->lookup(right, result)) {
+			return result;
+		}
+		{
+			Profiler::Scope call(funExpr);
+			result = funExpr->body->subst(funExpr->ident->value, arg)->eval();
+		}
+		if (funValue->memo && result) {
+			funValue->memo->insert(right, result);
+		}
+		return result;
 	}
 
-	const Type* type_syn(const Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+	const Type* type_syn(Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+		if (synType) { return synType; }
 		const Type* funType = fun->type_syn(typeCtx);
 		if (!funType) { return nullptr; }
 		const TArrow* arrowType = funType->as<TArrow>();
+		if (!arrowType && funType->as<TVar>()) {
+			// function of unknown type: it must be an arrow
+			arrowType = new TArrow(TVar::fresh(), TVar::fresh());
+			Type::unify(funType, arrowType);
+		}
 		if (!arrowType) {
 			if (reportErrors) {
 				std::ostringstream oss;
@@ -53,15 +75,26 @@ public:
 			if (reportErrors) {
 				std::ostringstream oss;
 				oss << "expected expression of type " << arrowType->left << " as function argument";
-				arg->report_error_at_expr(oss.str());
+				arg->report_error_at_expr(Type::unify_error(oss.str()));
 			}
 			return nullptr;
 		}
-		return arrowType->right;
+		return synType = arrowType->right;
+	}
+
+	bool type_ana(const Type* type, Context<const Type*>& typeCtx) const override {
+		const Type* synthesized = type_syn(typeCtx);
+		return synthesized && Type::unify(synthesized, type);
+	}
+
+	void free_vars(std::unordered_set<std::string>& vars) const override {
+		fun->free_vars(vars);
+		arg->free_vars(vars);
 	}
 
-	bool type_ana(const Type* type, const Context<const Type*>& typeCtx) const override {
-		return type_syn(typeCtx, false) == type;
+	void for_each_child(const std::function<void(Expr*&)>& fun) override {
+		fun(this->fun);
+		fun(arg);
 	}
 
 	void print_impl(std::ostream& os) const override {
@@ -12,14 +12,16 @@ public:
 		: Expr(loc, typeAnn), test(test), body(body), elseBody(elseBody) {}
 
 	Expr* copy() const override {
-		return new EIf(loc, typeAnn, test->copy(), body->copy(), elseBody->copy());
+		Stats::count(Stats::copies);
+		return with_type(new EIf(loc, typeAnn, test->copy(), body->copy(), elseBody->copy()));
 	}
 
 	Expr* subst(const std::string& subIdent, const Expr* subExpr) const override {
+		Stats::count(Stats::substCalls);
 		Expr* newTest = test->subst(subIdent, subExpr);
 		Expr* newBody = body->subst(subIdent, subExpr);
 		Expr* newElseBody = elseBody->subst(subIdent, subExpr);
-		return new EIf(loc, typeAnn, newTest, newBody, newElseBody);
+		return with_type(new EIf(loc, typeAnn, newTest, newBody, newElseBody));
 	}
 
 	Value* eval() const override {
@@ -41,7 +43,8 @@ public:
 		}
 	}
 
-	const Type* type_syn(const Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+	const Type* type_syn(Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+		if (synType) { return synType; }
 		if (!test->type_ana(Type::Bool(), typeCtx)) {
 			if (reportErrors) {
 				test->report_error_at_expr("expected test expression of bool type");
@@ -52,24 +55,40 @@ public:
 		if (!bodyType) { return nullptr; }
 		const Type* elseBodyType = elseBody->type_syn(typeCtx);
 		if (!elseBodyType) { return nullptr; }
-		if (!bodyType->equal(elseBodyType)) {
+		if (!Type::unify(bodyType, elseBodyType)) {
 			if (reportErrors) {
 				std::ostringstream oss;
 				oss << "both branches must synthesize same type; true branch synthesizes " << bodyType
 				    << " and false branch synthesizes " << elseBodyType;
-				report_error_at_expr(oss.str());
+				report_error_at_expr(Type::unify_error(oss.str()));
 			}
 			return nullptr;
 		}
-		return bodyType;
+		return synType = bodyType;
 	}
 
-	bool type_ana(const Type* type, const Context<const Type*>& typeCtx) const override {
+	bool type_ana(const Type* type, Context<const Type*>& typeCtx) const override {
 		if (!test->type_ana(Type::Bool(), typeCtx)) {
 			test->report_error_at_expr("expected test expression of bool type");
 			return false;
 		}
-		return body->type_ana(type, typeCtx) && elseBody->type_ana(type, typeCtx);
+		if (!body->type_ana(type, typeCtx) || !elseBody->type_ana(type, typeCtx)) {
+			return false;
+		}
+		synType = type;
+		return true;
+	}
+
+	void free_vars(std::unordered_set<std::string>& vars) const override {
+		test->free_vars(vars);
+		body->free_vars(vars);
+		elseBody->free_vars(vars);
+	}
+
+	void for_each_child(const std::function<void(Expr*&)>& fun) override {
+		fun(test);
+		fun(body);
+		fun(elseBody);
 	}
 
 	void print_impl(std::ostream& os) const override {
@@ -6,31 +6,44 @@
 class EIntLit : public Expr {
 public:
 	long long value;
+	// set only for a value that does not fit in a long long (see VInt)
+	const BigInt* big;
 
-	EIntLit(const Location& loc, const Type* typeAnn, long long value)
-		: Expr(loc, typeAnn), value(value) {}
+	EIntLit(const Location& loc, const Type* typeAnn, long long value, const BigInt* big = nullptr)
+		: Expr(loc, typeAnn), value(value), big(big) {}
 
 	Expr* copy() const override {
-		return new EIntLit(loc, typeAnn, value);
+		Stats::count(Stats::copies);
+		return with_type(new EIntLit(loc, typeAnn, value, big));
 	}
 
 	Expr* subst(const std::string& subIdent, const Expr* subExpr) const override {
+		Stats::count(Stats::substCalls);
 		return copy();
 	}
 
 	Value* eval() const override {
-		return new VInt(value);
+		return new VInt(value, big);
 	}
 
-	const Type* type_syn(const Context<const Type*>& typeCtx, bool reportErrors = true) const override {
-		return Type::Int();
+	const Type* type_syn(Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+		return synType = Type::Int();
 	}
 
-	bool type_ana(const Type* type, const Context<const Type*>& typeCtx) const override {
-		return type_syn(typeCtx, false) == type;
+	bool type_ana(const Type* type, Context<const Type*>& typeCtx) const override {
+		const Type* synthesized = type_syn(typeCtx);
+		return synthesized && Type::unify(synthesized, type);
 	}
 
+	void free_vars(std::unordered_set<std::string>& vars) const override {}
+
+	void for_each_child(const std::function<void(Expr*&)>& fun) override {}
+
 	void print_impl(std::ostream& os) const override {
-		os << value;
+		if (big) {
+			os << big->to_string();
+		} else {
+			os << value;
+		}
 	}
 };
@@ -2,21 +2,27 @@
 
 #include "../Expr.h"
 #include "EVar.h"
+#include "../ParallelChecker.h"
 
 class ELet : public Expr {
 public:
 	EVar* ident;
 	Expr* value;
 	Expr* body;
+	// strict bindings evaluate their value once, before the body, and
+	// substitute the result (used for bindings synthesized by the optimizer)
+	bool strict;
 
-	ELet(const Location& loc, const Type* typeAnn, EVar* ident, Expr* value, Expr* body)
-		: Expr(loc, typeAnn), ident(ident), value(value), body(body) {}
+	ELet(const Location& loc, const Type* typeAnn, EVar* ident, Expr* value, Expr* body, bool strict = false)
+		: Expr(loc, typeAnn), ident(ident), value(value), body(body), strict(strict) {}
 
 	Expr* copy() const override {
-		return new ELet(loc, typeAnn, ident, value->copy(), body->copy());
+		Stats::count(Stats::copies);
+		return with_type(new ELet(loc, typeAnn, ident, value->copy(), body->copy(), strict));
 	}
 
 	Expr* subst(const std::string& subIdent, const Expr* subExpr) const override {
+		Stats::count(Stats::substCalls);
 		Expr* newValue = value->subst(subIdent, subExpr);
 		Expr* newBody;
 		if (subIdent != ident->value) {
@@ -24,50 +30,91 @@ public:
 		} else {
 			newBody = body->copy();
 		}
-		return new ELet(loc, typeAnn, ident, newValue, newBody);
+		return with_type(new ELet(loc, typeAnn, ident, newValue, newBody, strict));
 	}
 
 	Value* eval() const override {
+		HeapProfiler::Scope site(this, "let");
+		if (strict) {
+			Value* result = value->eval();
+			if (!result) { return nullptr; }
+			return body->subst(ident->value, from_value(result, value->loc))->eval();
+		}
 		return body->subst(ident->value, value)->eval();
 	}
 
-	const Type* type_syn(const Context<const Type*>& typeCtx, bool reportErrors = true) const override {
-		const Type* valueType = nullptr;
+	// type bound to ident by 'let ident = value'; unannotated values are generalized
+	// (also used for top-level REPL definitions)
+	static const Type* binding_type(const EVar* ident, const Expr* value, Context<const Type*>& typeCtx, bool reportErrors) {
 		if (ident->typeAnn) {
 			if (!value->type_ana(ident->typeAnn, typeCtx)) {
 				if (reportErrors) {
 					std::ostringstream oss;
 					oss << "expected expression of type " << ident->typeAnn;
-					value->report_error_at_expr(oss.str());
+					value->report_error_at_expr(Type::unify_error(oss.str()));
 				}
 				return nullptr;
 			}
-			valueType = ident->typeAnn;
-		} else {
-			valueType = value->type_syn(typeCtx);
-			if (!valueType) { return nullptr; }
+			return ident->typeAnn;
 		}
-		Context<const Type*> ctx = typeCtx;
-		ctx.push(ident->value, valueType);
-		return body->type_syn(ctx);
+		TVar::enter_level();
+		const Type* valueType = value->type_syn(typeCtx);
+		TVar::leave_level();
+		if (!valueType) { return nullptr; }
+		return Type::generalize(valueType);
 	}
 
-	bool type_ana(const Type* type, const Context<const Type*>& typeCtx) const override {
-		const Type* valueType = nullptr;
+	const Type* type_syn(Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+		if (synType) { return synType; }
 		if (ident->typeAnn) {
-			if (!value->type_ana(ident->typeAnn, typeCtx)) {
-				return false;
-			}
-			valueType = ident->typeAnn;
-		} else {
-			valueType = value->type_syn(typeCtx);
-			if (!valueType) {
-				return false;
-			}
+			// the body sees the annotated type, whatever the value's, so the
+			// value and body may be checked in parallel
+			const Type* bodyType = nullptr;
+			bool ok = ParallelChecker::check_both(value, body, typeCtx, [&](Context<const Type*>& ctx) {
+				return binding_type(ident, value, ctx, reportErrors) != nullptr;
+			}, [&](Context<const Type*>& ctx) {
+				ctx.push(ident->value, ident->typeAnn);
+				bodyType = body->type_syn(ctx);
+				ctx.pop(ident->value);
+				return bodyType != nullptr;
+			});
+			if (!ok) { return nullptr; }
+			return synType = bodyType;
+		}
+		const Type* valueType = binding_type(ident, value, typeCtx, reportErrors);
+		if (!valueType) { return nullptr; }
+		typeCtx.push(ident->value, valueType);
+		synType = body->type_syn(typeCtx);
+		typeCtx.pop(ident->value);
+		return synType;
+	}
+
+	bool type_ana(const Type* type, Context<const Type*>& typeCtx) const override {
+		const Type* valueType = binding_type(ident, value, typeCtx, false);
+		if (!valueType) {
+			return false;
 		}
-		Context<const Type*> ctx = typeCtx;
-		ctx.push(ident->value, valueType);
-		return body->type_ana(type, ctx);
+		typeCtx.push(ident->value, valueType);
+		bool ok = body->type_ana(type, typeCtx);
+		typeCtx.pop(ident->value);
+		if (!ok) {
+			return false;
+		}
+		synType = type;
+		return true;
+	}
+
+	void free_vars(std::unordered_set<std::string>& vars) const override {
+		value->free_vars(vars);
+		std::unordered_set<std::string> bodyVars;
+		body->free_vars(bodyVars);
+		bodyVars.erase(ident->value);
+		vars.insert(bodyVars.begin(), bodyVars.end());
+	}
+
+	void for_each_child(const std::function<void(Expr*&)>& fun) override {
+		fun(value);
+		fun(body);
 	}
 
 	void print_impl(std::ostream& os) const override {
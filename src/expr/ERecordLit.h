@@ -29,19 +29,21 @@ public:
 	}
 
 	Expr* copy() const override {
+		Stats::count(Stats::copies);
 		std::vector<Field> fieldsCopy;
 		for (const std::string& ident : idents) {
 			fieldsCopy.push_back({ ident, fields.at(ident)->copy() });
 		}
-		return new ERecordLit(loc, typeAnn, fieldsCopy);
+		return with_type(new ERecordLit(loc, typeAnn, fieldsCopy));
 	}
 
 	Expr* subst(const std::string& subIdent, const Expr* subExpr) const override {
+		Stats::count(Stats::substCalls);
 		std::vector<Field> fieldsCopy;
 		for (const std::string& ident : idents) {
 			fieldsCopy.push_back({ ident, fields.at(ident)->subst(subIdent, subExpr) });
 		}
-		return new ERecordLit(loc, typeAnn, fieldsCopy);
+		return with_type(new ERecordLit(loc, typeAnn, fieldsCopy));
 	}
 
 	Value* eval() const override {
@@ -50,7 +52,8 @@ public:
 		return nullptr;
 	}
 
-	const Type* type_syn(const Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+	const Type* type_syn(Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+		if (synType) { return synType; }
 		if (!typeAnn) {
 			if (reportErrors) {
 				report_error_at_expr("failed to synthesize record type");
@@ -65,11 +68,14 @@ public:
 			}
 			return nullptr;
 		}
-		return typeAnn;
+		return synType = typeAnn;
 	}
 
-	bool type_ana(const Type* type, const Context<const Type*>& typeCtx) const override {
+	bool type_ana(const Type* type, Context<const Type*>& typeCtx) const override {
 		const TRecord* recordType = type->as<TRecord>();
+		if (!recordType && typeAnn && Type::unify(type, typeAnn)) {
+			recordType = typeAnn->as<TRecord>();
+		}
 		if (!recordType) { return false; }
 		if (recordType->fields.size() != fields.size()) { return false; }
 		for (auto& recordField : recordType->fields) {
@@ -77,9 +83,22 @@ public:
 			if (it == fields.end()) { return false; }
 			if (!it->second->type_ana(recordField.second, typeCtx)) { return false; }
 		}
+		synType = type;
 		return true;
 	}
 
+	void free_vars(std::unordered_set<std::string>& vars) const override {
+		for (const std::string& ident : idents) {
+			fields.at(ident)->free_vars(vars);
+		}
+	}
+
+	void for_each_child(const std::function<void(Expr*&)>& fun) override {
+		for (const std::string& ident : idents) {
+			fun(fields[ident]);
+		}
+	}
+
 	void print_impl(std::ostream& os) const override {
 		os << "{ ";
 		bool printComma = false;
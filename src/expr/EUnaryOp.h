@@ -11,15 +11,18 @@ public:
 		: Expr(loc, typeAnn), op(op), right(right) {}
 
 	Expr* copy() const override {
-		return new EUnaryOp(loc, typeAnn, op, right->copy());
+		Stats::count(Stats::copies);
+		return with_type(new EUnaryOp(loc, typeAnn, op, right->copy()));
 	}
 
 	Expr* subst(const std::string& subIdent, const Expr* subExpr) const override {
+		Stats::count(Stats::substCalls);
 		Expr* newRight = right->subst(subIdent, subExpr);
-		return new EUnaryOp(loc, typeAnn, op, newRight);
+		return with_type(new EUnaryOp(loc, typeAnn, op, newRight));
 	}
 
 	Value* eval() const override {
+		HeapProfiler::Scope site(this, "op");
 		Value* rightValue = right->eval();
 		if (!rightValue) { return nullptr; }
 		Value* result = OpDefinition::unary_op_result(op.type, rightValue);
@@ -29,11 +32,15 @@ public:
 		return result;
 	}
 
-	const Type* type_syn(const Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+	const Type* type_syn(Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+		if (synType) { return synType; }
 		// potential improvement: use (weaker) type analysis instead of synthesis?
 		const Type* rtype = right->type_syn(typeCtx);
 		if (!rtype) { return nullptr; }
-		const Type* result = OpDefinition::unary_op_type(op.type, rtype);
+		rtype = Type::resolve(rtype);
+		// an operand that is still unknown is decided later (see EBinaryOp)
+		const TVar* var = rtype->as<TVar>();
+		const Type* result = var ? OpDefinition::open_unary_op_type(op.type, var) : OpDefinition::unary_op_type(op.type, rtype);
 		if (!result) {
 			if (reportErrors) {
 				std::ostringstream oss;
@@ -42,11 +49,20 @@ public:
 			}
 			return nullptr;
 		}
-		return result;
+		return synType = result;
+	}
+
+	bool type_ana(const Type* type, Context<const Type*>& typeCtx) const override {
+		const Type* synthesized = type_syn(typeCtx);
+		return synthesized && Type::unify(synthesized, type);
+	}
+
+	void free_vars(std::unordered_set<std::string>& vars) const override {
+		right->free_vars(vars);
 	}
 
-	bool type_ana(const Type* type, const Context<const Type*>& typeCtx) const override {
-		return type_syn(typeCtx, false) == type;
+	void for_each_child(const std::function<void(Expr*&)>& fun) override {
+		fun(right);
 	}
 
 	void print_impl(std::ostream& os) const override {
@@ -9,10 +9,12 @@ public:
 		: Expr(loc, typeAnn) {}
 
 	Expr* copy() const override {
-		return new EUnitLit(loc, typeAnn);
+		Stats::count(Stats::copies);
+		return with_type(new EUnitLit(loc, typeAnn));
 	}
 
 	Expr* subst(const std::string& subIdent, const Expr* subExpr) const override {
+		Stats::count(Stats::substCalls);
 		return copy();
 	}
 
@@ -20,14 +22,19 @@ public:
 		return new VUnit();
 	}
 
-	const Type* type_syn(const Context<const Type*>& typeCtx, bool reportErrors = true) const override {
-		return Type::Unit();
+	const Type* type_syn(Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+		return synType = Type::Unit();
 	}
 
-	bool type_ana(const Type* type, const Context<const Type*>& typeCtx) const override {
-		return type_syn(typeCtx, false) == type;
+	bool type_ana(const Type* type, Context<const Type*>& typeCtx) const override {
+		const Type* synthesized = type_syn(typeCtx);
+		return synthesized && Type::unify(synthesized, type);
 	}
 
+	void free_vars(std::unordered_set<std::string>& vars) const override {}
+
+	void for_each_child(const std::function<void(Expr*&)>& fun) override {}
+
 	void print_impl(std::ostream& os) const override {
 		os << "()";
 	}
@@ -10,10 +10,12 @@ public:
 		: Expr(loc, typeAnn), value(std::move(value)) {}
 
 	Expr* copy() const override {
-		return new EVar(loc, typeAnn, value);
+		Stats::count(Stats::copies);
+		return with_type(new EVar(loc, typeAnn, value));
 	}
 
 	Expr* subst(const std::string& subIdent, const Expr* subExpr) const override {
+		Stats::count(Stats::substCalls);
 		if (value == subIdent) {
 			return subExpr->copy();
 		} else {
@@ -26,7 +28,8 @@ public:
 		return nullptr;
 	}
 
-	const Type* type_syn(const Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+	const Type* type_syn(Context<const Type*>& typeCtx, bool reportErrors = true) const override {
+		if (synType) { return synType; }
 		const Type* type = typeCtx.get(value);
 		if (!type) {
 			if (reportErrors) {
@@ -34,14 +37,22 @@ public:
 			}
 			return nullptr;
 		} else {
-			return type;
+			// each use of a let-bound polymorphic value gets its own type variables
+			return synType = Type::instantiate(type);
 		}
 	}
 
-	bool type_ana(const Type* type, const Context<const Type*>& typeCtx) const override {
-		return type_syn(typeCtx, false) == type;
+	bool type_ana(const Type* type, Context<const Type*>& typeCtx) const override {
+		const Type* synthesized = type_syn(typeCtx);
+		return synthesized && Type::unify(synthesized, type);
 	}
 
+	void free_vars(std::unordered_set<std::string>& vars) const override {
+		vars.insert(value);
+	}
+
+	void for_each_child(const std::function<void(Expr*&)>& fun) override {}
+
 	void print_impl(std::ostream& os) const override {
 		os << value;
 	}
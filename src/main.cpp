@@ -1,114 +1,583 @@
 #include <deque>
+#include <chrono>
 #include <cstdio>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <thread>
+#include <algorithm>
 #include <iostream>
+#include <vector>
+#include <optional>
+#include <unordered_set>
 #include "Type.h"
 #include "Lexer.h"
 #include "Parser.h"
 #include "Source.h"
 #include "Context.h"
+#include "AstCache.h"
+#include "Runtime.h"
+#include "Server.h"
+#include "ThreadPool.h"
+#include "ParallelChecker.h"
+#include "ResultCache.h"
+#include "Optimizer.h"
+#include "MemoTable.h"
+#include "Stats.h"
+#include "Profiler.h"
+#include "HeapProfiler.h"
 
 /**
  * File input: reads from file
  * Repl input: reads from cin
+ * Batch input: reads each listed file (--batch)
+ * Serve input: reads programs from clients of a socket (--serve)
  */
-enum class InputMode { File, Repl };
+enum class InputMode { File, Repl, Batch, Serve };
 
 // compilation mode will be added later
-enum class OutputMode { Eval, Lex, Parse, Type };
+enum class OutputMode { Eval, Lex, Parse, Type, Opt };
 
-int run(std::istream& is, const std::string& filepath, OutputMode outputMode) {
-	// initialize source
-	Source source(is, filepath);
+// run optimization passes between type checking and evaluation (disable with --no-opt)
+bool optimize = true;
+// cache results of closed recursive functions (--memo)
+bool memoize = false;
+// print --stats output as JSON (--stats=json)
+bool statsJson = false;
+// --profile output: folded stacks file and length of the top functions table
+std::string profilePath = "alc.folded";
+int profileTop = 20;
 
-	// lex
-	Lexer lexer(source);
-	std::deque<Token> tokens = lexer.get_tokens();
-	if (source.has_errors()) {
-		source.emit_errors(std::cout);
-		return 1;
+// parses a whole command line number that must be positive and at most max
+bool parse_positive(const char* text, long long max, long long& value) {
+	char* end;
+	errno = 0;
+	value = strtoll(text, &end, 10);
+	return end != text && !*end && errno == 0 && value > 0 && value <= max;
+}
+
+// REPL state carried from one entry to the next
+struct Session {
+	// declared types, and types and values of top-level definitions
+	std::unordered_map<std::string, const Type*> typeTable;
+	Context<const Type*> typeCtx;
+	Context<const Value*> values;
+	// sources of earlier entries (their ASTs live on in values)
+	std::deque<Source> sources;
+
+	Session() {}
+
+	// a session with the same definitions; entries run in the fork do not
+	// affect this one (sources are not copied, since the values keep theirs alive)
+	Session fork() const {
+		Session session;
+		session.typeTable = typeTable;
+		session.typeCtx = typeCtx;
+		session.values = values;
+		return session;
 	}
-	if (outputMode == OutputMode::Lex) {
-		for (Token token : tokens) {
-			std::cout << token << ' ';
+
+	// substitutes the values of earlier definitions into expr, making it closed
+	Expr* close(Expr* expr) const {
+		std::unordered_set<std::string> freeVars;
+		expr->free_vars(freeVars);
+		for (const std::string& ident : freeVars) {
+			if (const Value* value = values.get(ident)) {
+				expr = expr->subst(ident, Expr::from_value(value, expr->loc));
+			}
 		}
-		std::cout << std::endl;
-		return 0;
+		return expr;
 	}
+};
 
-	// parse
-	Parser parser(std::move(tokens));
-	Expr* ast = parser.parse();
-	if (source.has_errors()) {
-		source.emit_errors(std::cout);
-		return 1;
+// printed result of a successful run (type only for --type)
+struct Result {
+	std::string value;
+	std::string type;
+};
+
+// times the phases of one run and prints them with the counters (--stats)
+// when the run returns, however far it got
+struct StatsReport {
+	std::ostream& log;
+	Stats::Phases phases;
+	std::vector<std::pair<std::string, long long>> start;
+	std::chrono::steady_clock::time_point phaseStart = std::chrono::steady_clock::now();
+
+	StatsReport(std::ostream& log) : log(log), start(Stats::counters()) {}
+
+	~StatsReport() {
+		if (Stats::enabled) {
+			Stats::print(log, phases, start, statsJson);
+		}
+	}
+
+	// the phase that just finished
+	void end_phase(const std::string& name) {
+		auto now = std::chrono::steady_clock::now();
+		phases.push_back({ name, std::chrono::duration<double, std::milli>(now - phaseStart).count() });
+		phaseStart = now;
+	}
+};
+
+// output goes to os, statistics to log, and folded stacks (--profile) to
+// foldedPath
+int run(std::istream& is, const std::string& filepath, OutputMode outputMode,
+        std::ostream& os, std::ostream& log, Session* session = nullptr, Result* result = nullptr,
+        const std::string& foldedPath = profilePath) {
+	StatsReport stats(log);
+
+	// initialize source
+	std::optional<Source> fileSource;
+	Source& source = session ? session->sources.emplace_back(is, filepath) : fileSource.emplace(is, filepath);
+	stats.end_phase("source");
+
+	// a cached artifact of this source replaces lexing, parsing and type checking
+	// (not for session entries: their AST depends on the session's declared
+	// types and definitions, which are not part of the source)
+	bool useCache = !session && !AstCache::directory.empty()
+	                && outputMode != OutputMode::Lex && outputMode != OutputMode::Parse;
+	Expr* ast = useCache ? AstCache::load(source) : nullptr;
+	if (useCache) {
+		stats.end_phase("cache");
 	}
+	const Type* type = ast ? ast->synType : nullptr;
+	EVar* defIdent = nullptr;
 	if (!ast) {
-		throw std::runtime_error("Received invalid AST without emitting errors");
+		// lex
+		Lexer lexer(source);
+		std::deque<Token> tokens = lexer.get_tokens();
+		stats.end_phase("lex");
+		Stats::count(Stats::tokens, tokens.size());
+		if (source.has_errors()) {
+			source.emit_errors(os);
+			return 1;
+		}
+		if (outputMode == OutputMode::Lex) {
+			for (Token token : tokens) {
+				os << token << ' ';
+			}
+			os << std::endl;
+			return 0;
+		}
+
+		// parse (in the REPL, 'let x = e' without 'in' defines x for later entries)
+		Parser parser = session ? Parser(std::move(tokens), session->typeTable) : Parser(std::move(tokens));
+		ast = session ? parser.parse_entry(defIdent) : parser.parse();
+		stats.end_phase("parse");
+		if (ast) {
+			Stats::count(Stats::astNodes, Optimizer::size(ast));
+		}
+		if (source.has_errors()) {
+			source.emit_errors(os);
+			return 1;
+		}
+		if (session) {
+			session->typeTable = parser.get_type_table();
+			if (!ast) { return 0; }
+		}
+		if (!ast) {
+			throw std::runtime_error("Received invalid AST without emitting errors");
+		}
+		if (outputMode == OutputMode::Parse) {
+			if (defIdent) {
+				os << "let " << defIdent << " = ";
+			}
+			os << ast << std::endl;
+			return 0;
+		}
+
+		// type-check
+		Context<const Type*> fileTypeCtx;
+		Context<const Type*>& typeCtx = session ? session->typeCtx : fileTypeCtx;
+		type = defIdent
+		       ? ELet::binding_type(defIdent, ast, typeCtx, true)
+		       : ast->type_syn(typeCtx);
+		if (type) {
+			Type::default_operands(type);
+		}
+		stats.end_phase("typecheck");
+		if (source.has_errors()) {
+			source.emit_errors(os);
+			return 1;
+		}
+		if (!type) {
+			throw std::runtime_error("Failed to synthesize type without reporting errors");
+		}
+		if (useCache) {
+			AstCache::store(source, ast);
+			stats.end_phase("cache");
+		}
 	}
-	if (outputMode == OutputMode::Parse) {
-		std::cout << ast << std::endl;
+	if (outputMode == OutputMode::Type) {
+		os << type << std::endl;
+		if (result) {
+			std::ostringstream typeString;
+			typeString << type;
+			result->type = typeString.str();
+		}
 		return 0;
 	}
 
-	// type-check
-	const Type* type = ast->type_syn(Context<const Type*>());
-	if (source.has_errors()) {
-		source.emit_errors(std::cout);
-		return 1;
+	// only the new entry is compiled; earlier definitions come in as values
+	if (session) {
+		ast = session->close(ast);
 	}
-	if (!type) {
-		throw std::runtime_error("Failed to synthesize type without reporting errors");
+
+	// a repeated program prints its cached result without being evaluated; a
+	// closed session entry is keyed with the definitions substituted into it,
+	// but an entry defining a name must run to bind it
+	bool useResultCache = !defIdent && !ResultCache::directory.empty() && outputMode == OutputMode::Eval;
+	std::string normalized;
+	uint64_t resultKey = 0;
+	if (useResultCache) {
+		normalized = ResultCache::normalize(ast, type);
+		resultKey = ResultCache::key(normalized);
+		std::string cached;
+		bool hit = ResultCache::lookup(resultKey, normalized, cached);
+		stats.end_phase("result-cache");
+		if (hit) {
+			os << cached << std::endl;
+			if (result) {
+				std::ostringstream typeString;
+				typeString << type;
+				result->type = typeString.str();
+				// the cached line is 'value : type'
+				result->value = cached.substr(0, cached.size() - result->type.size() - 3);
+			}
+			ResultCache::print_stats(log);
+			return 0;
+		}
 	}
-	if (outputMode == OutputMode::Type) {
-		std::cout << type << std::endl;
+
+	// optimize
+	if (optimize) {
+		ast = Optimizer::optimize(ast);
+		stats.end_phase("optimize");
+	}
+	if (outputMode == OutputMode::Opt) {
+		os << ast << std::endl;
 		return 0;
 	}
 
 	// evaluate
+	if (memoize) {
+		Runtime::enable_memoization(ast);
+	}
+	if (Profiler::enabled) {
+		Profiler::reset();
+		Profiler::name_functions(ast);
+	}
+	// only evaluation's allocations are reported
+	if (HeapProfiler::enabled) {
+		HeapProfiler::reset(log);
+	}
 	Value* value = ast->eval();
+	stats.end_phase("eval");
+	if (HeapProfiler::enabled) {
+		HeapProfiler::print_report(log, profileTop);
+	}
+	if (Profiler::enabled) {
+		std::ofstream folded(foldedPath);
+		Profiler::write_folded(folded);
+		Profiler::print_top(log, profileTop);
+		log << "profile: folded stacks written to " << foldedPath << std::endl;
+	}
 	if (source.has_errors()) {
-		source.emit_errors(std::cout);
+		source.emit_errors(os);
 		return 1;
 	}
 	if (!value) {
 		throw std::runtime_error("Received invalid value without emitting errors");
 	}
-	std::cout << value << " : " << value->get_type() << std::endl;
+	if (defIdent) {
+		session->typeCtx.push(defIdent->value, type);
+		session->values.push(defIdent->value, value);
+		os << defIdent->value << " = ";
+	}
+	// the checker already knows the result type; no need to ask the value
+	std::ostringstream valueString;
+	std::ostringstream typeString;
+	valueString << value;
+	typeString << type;
+	std::string line = valueString.str() + " : " + typeString.str();
+	os << line << std::endl;
+	if (result) {
+		result->value = valueString.str();
+		result->type = typeString.str();
+	}
+	if (useResultCache) {
+		ResultCache::insert(resultKey, normalized, line);
+		ResultCache::print_stats(log);
+	}
+	if (memoize) {
+		log << "memo: " << MemoTable::hits << " hits, " << MemoTable::misses << " misses, "
+		          << MemoTable::entries << " entries" << std::endl;
+	}
 	return 0;
 }
 
+// compiles and evaluates each file on a pool of numThreads threads;
+// every file's output is buffered and printed in input order, and the
+// folded stacks of the nth file (--profile) go to profilePath.n
+int run_batch(const std::vector<std::string>& files, OutputMode outputMode, int numThreads) {
+	struct Job {
+		std::ostringstream os;
+		std::ostringstream log;
+		int status = 1;
+	};
+	std::vector<Job> jobs(files.size());
+	std::vector<ThreadPool::Task*> tasks;
+	ThreadPool pool(numThreads);
+	for (size_t i = 0; i < files.size(); ++i) {
+		tasks.push_back(new ThreadPool::Task([&files, &jobs, outputMode, i]() {
+			Job& job = jobs[i];
+			std::ifstream ifs(files[i]);
+			if (!ifs) {
+				job.os << "Invalid file path: " << files[i] << std::endl;
+				return;
+			}
+			try {
+				std::string foldedPath = profilePath + "." + std::to_string(i + 1);
+				job.status = run(ifs, files[i], outputMode, job.os, job.log, nullptr, nullptr, foldedPath);
+			} catch (const std::exception& e) {
+				job.os << files[i] << ": internal error: " << e.what() << std::endl;
+			}
+		}));
+		pool.spawn(tasks.back());
+	}
+	int status = 0;
+	for (size_t i = 0; i < files.size(); ++i) {
+		// waiting runs queued files on this thread too
+		pool.wait(tasks[i]);
+		delete tasks[i];
+		std::cout << "==> " << files[i] << " <==" << std::endl;
+		std::cout << jobs[i].os.str() << std::flush;
+		std::cerr << jobs[i].log.str() << std::flush;
+		if (jobs[i].status != 0) {
+			status = 1;
+		}
+	}
+	return status;
+}
+
+// answers programs sent to a Unix domain socket (see Server.h); the prelude's
+// definitions are compiled once and available to every request
+int run_server(const std::string& path, OutputMode outputMode, int numThreads, const std::string& preludePath) {
+	Session prelude;
+	if (!preludePath.empty()) {
+		std::ifstream ifs(preludePath);
+		if (!ifs) {
+			std::cout << "Invalid prelude path: " << preludePath << std::endl;
+			return 1;
+		}
+		// entries are separated by blank lines, as in the REPL
+		std::stringstream entry;
+		bool hasEntry = false;
+		std::string line;
+		while (true) {
+			bool more = (bool)std::getline(ifs, line);
+			if (more && !line.empty()) {
+				entry << line << "\n";
+				hasEntry = true;
+				continue;
+			}
+			if (hasEntry) {
+				std::ostringstream os;
+				if (run(entry, preludePath, OutputMode::Eval, os, std::cerr, &prelude) != 0) {
+					std::cout << os.str();
+					return 1;
+				}
+				entry = std::stringstream();
+				hasEntry = false;
+			}
+			if (!more) { break; }
+		}
+	}
+	bool hasPrelude = !preludePath.empty();
+	return Server::serve(path, numThreads, [&prelude, hasPrelude, outputMode](const std::string& program) {
+		Server::Response response;
+		std::istringstream is(program);
+		std::ostringstream os;
+		std::ostringstream log;
+		Session session = prelude.fork();
+		Result result;
+		try {
+			response.status = run(is, "request", outputMode, os, log, hasPrelude ? &session : nullptr, &result);
+		} catch (const std::exception& e) {
+			os << "internal error: " << e.what() << std::endl;
+		}
+		response.output = os.str();
+		if (response.status == 0) {
+			response.value = result.value;
+			response.type = result.type;
+		}
+		return response;
+	});
+}
+
 int main(int argc, char* argv[]) {
 	if (argc < 2) {
 		std::cout << "No input file provided" << std::endl;
 		return 1;
 	}
 	if (argc >= 2 && (!strcmp(argv[1], "--help") || !strcmp(argv[1], "-h"))) {
-		std::cout << "Usage: alc file|--repl [--lex|--parse|--type]" << std::endl;
+		std::cout << "Usage: alc file|--repl|--batch [-j N] file...|@manifest...|--serve SOCKET [-j N] [--prelude=FILE] [--lex|--parse|--type|--dump-opt] [--no-opt] [--parallel=N] [--parallel-check] [--memo[=MAX_ENTRIES]] [--cache[=DIR]] [--result-cache[=DIR]] [--result-cache-size=BYTES] [--stats[=json]] [--profile[=FILE]] [--profile-top=N] [--heap-profile[=SNAPSHOT_BYTES]]" << std::endl;
 		return 0;
 	}
 
 	InputMode inputMode = !strcmp(argv[1], "--repl")
 	                      ? InputMode::Repl
+	                      : !strcmp(argv[1], "--batch")
+	                      ? InputMode::Batch
+	                      : !strcmp(argv[1], "--serve")
+	                      ? InputMode::Serve
 	                      : InputMode::File;
-	std::ifstream ifs(argv[1]);
+	std::ifstream ifs;
+	if (inputMode == InputMode::File) {
+		ifs.open(argv[1]);
+	}
 	std::istream& is = inputMode == InputMode::Repl
 	                   ? std::cin
 	                   : ifs;
-	if (!is) {
+	if (inputMode == InputMode::File && !is) {
 		std::cout << "Invalid file path: " << argv[1] << std::endl;
 		return 1;
 	}
 
+	if (inputMode == InputMode::Serve && argc < 3) {
+		std::cout << "No socket path provided" << std::endl;
+		return 1;
+	}
+
 	OutputMode outputMode = OutputMode::Eval;
-	if (argc >= 3) {
-		if (!strcmp(argv[2], "--lex")) {
+	// batch and serve modes: files to run, and the number of worker threads
+	// (-j; 0 until given)
+	std::vector<std::string> batchFiles;
+	int numThreads = 0;
+	std::string preludePath;
+	for (int i = inputMode == InputMode::Serve ? 3 : 2; i < argc; ++i) {
+		if (inputMode == InputMode::Batch && argv[i][0] != '-') {
+			if (argv[i][0] == '@') {
+				// manifest: one file per line; blank lines and '#' comments are skipped
+				std::ifstream manifest(argv[i] + 1);
+				if (!manifest) {
+					std::cout << "Invalid manifest path: " << argv[i] + 1 << std::endl;
+					return 1;
+				}
+				std::string line;
+				while (std::getline(manifest, line)) {
+					if (!line.empty() && line[0] != '#') {
+						batchFiles.push_back(line);
+					}
+				}
+			} else {
+				batchFiles.push_back(argv[i]);
+			}
+		} else if ((inputMode == InputMode::Batch || inputMode == InputMode::Serve) && !strncmp(argv[i], "-j", 2)) {
+			const char* count = argv[i][2] ? argv[i] + 2 : i + 1 < argc ? argv[++i] : "";
+			numThreads = atoi(count);
+			if (numThreads < 1) {
+				std::cout << "Invalid thread count: " << count << std::endl;
+				return 1;
+			}
+		} else if (inputMode == InputMode::Serve && !strncmp(argv[i], "--prelude=", 10)) {
+			preludePath = argv[i] + 10;
+		} else if (!strcmp(argv[i], "--lex")) {
 			outputMode = OutputMode::Lex;
-		} else if (!strcmp(argv[2], "--parse")) {
+		} else if (!strcmp(argv[i], "--parse")) {
 			outputMode = OutputMode::Parse;
-		} else if (!strcmp(argv[2], "--type")) {
+		} else if (!strcmp(argv[i], "--type")) {
 			outputMode = OutputMode::Type;
+		} else if (!strcmp(argv[i], "--dump-opt")) {
+			outputMode = OutputMode::Opt;
+		} else if (!strcmp(argv[i], "--no-opt")) {
+			optimize = false;
+		} else if (!strncmp(argv[i], "--parallel=", 11)) {
+			int numThreads = atoi(argv[i] + 11);
+			if (numThreads < 1) {
+				std::cout << "Invalid thread count: " << argv[i] << std::endl;
+				return 1;
+			}
+			Runtime::set_parallelism(numThreads);
+		} else if (!strcmp(argv[i], "--parallel-check")) {
+			ParallelChecker::enable();
+		} else if (!strcmp(argv[i], "--memo")) {
+			memoize = true;
+		} else if (!strncmp(argv[i], "--memo=", 7)) {
+			long long maxEntries = atoll(argv[i] + 7);
+			if (maxEntries < 1) {
+				std::cout << "Invalid memo table size: " << argv[i] << std::endl;
+				return 1;
+			}
+			memoize = true;
+			MemoTable::maxEntries = maxEntries;
+		} else if (!strcmp(argv[i], "--stats")) {
+			Stats::enabled = true;
+		} else if (!strcmp(argv[i], "--stats=json")) {
+			Stats::enabled = true;
+			statsJson = true;
+		} else if (!strcmp(argv[i], "--profile")) {
+			Profiler::enabled = true;
+		} else if (!strncmp(argv[i], "--profile=", 10)) {
+			Profiler::enabled = true;
+			profilePath = argv[i] + 10;
+		} else if (!strncmp(argv[i], "--profile-top=", 14)) {
+			long long top;
+			if (!parse_positive(argv[i] + 14, INT_MAX, top)) {
+				std::cout << "Invalid profile table length (expected a positive number): " << argv[i] << std::endl;
+				return 1;
+			}
+			profileTop = top;
+		} else if (!strcmp(argv[i], "--heap-profile")) {
+			HeapProfiler::enabled = true;
+		} else if (!strncmp(argv[i], "--heap-profile=", 15)) {
+			long long snapshotBytes;
+			if (!parse_positive(argv[i] + 15, LLONG_MAX, snapshotBytes)) {
+				std::cout << "Invalid heap snapshot interval (expected a positive number of bytes): " << argv[i] << std::endl;
+				return 1;
+			}
+			HeapProfiler::enabled = true;
+			HeapProfiler::snapshotBytes = snapshotBytes;
+		} else if (!strcmp(argv[i], "--cache")) {
+			AstCache::directory = AstCache::default_directory();
+		} else if (!strncmp(argv[i], "--cache=", 8)) {
+			AstCache::directory = argv[i] + 8;
+		} else if (!strcmp(argv[i], "--result-cache")) {
+			ResultCache::directory = AstCache::default_directory() + "/results";
+		} else if (!strncmp(argv[i], "--result-cache=", 15)) {
+			ResultCache::directory = argv[i] + 15;
+		} else if (!strncmp(argv[i], "--result-cache-size=", 20)) {
+			long long maxBytes = atoll(argv[i] + 20);
+			if (maxBytes < 1) {
+				std::cout << "Invalid result cache size: " << argv[i] << std::endl;
+				return 1;
+			}
+			ResultCache::maxBytes = maxBytes;
+		}
+	}
+
+	// the counters and the profiles are process-wide, so each run's report
+	// needs the runs of batch and serve modes to happen one at a time;
+	// otherwise a server answers a connection per core unless told otherwise
+	if (numThreads == 0) {
+		bool reports = Stats::enabled || Profiler::enabled || HeapProfiler::enabled;
+		numThreads = inputMode == InputMode::Serve && !reports ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+	}
+	if ((inputMode == InputMode::Batch || inputMode == InputMode::Serve) && numThreads > 1) {
+		if (Stats::enabled) {
+			std::cout << "--stats needs -j 1" << std::endl;
+			return 1;
+		}
+		if (Profiler::enabled) {
+			std::cout << "--profile needs -j 1" << std::endl;
+			return 1;
+		}
+		if (HeapProfiler::enabled) {
+			std::cout << "--heap-profile needs -j 1" << std::endl;
+			return 1;
 		}
 	}
 
@@ -120,18 +589,23 @@ int main(int argc, char* argv[]) {
 	std::cout << std::endl;
 
 	if (inputMode == InputMode::Repl) {
+		Session session;
 		std::stringstream ss;
 		std::string input;
 		while (std::getline(is, input)) {
 			if (input.empty()) {
 				std::cout << "\x1b[A"; // go up a line
-				run(ss, "", outputMode);
+				run(ss, "", outputMode, std::cout, std::cerr, &session);
 				ss = std::stringstream();
 			} else {
 				ss << input << "\n";
 			}
 		}
+	} else if (inputMode == InputMode::Batch) {
+		return run_batch(batchFiles, outputMode, numThreads);
+	} else if (inputMode == InputMode::Serve) {
+		return run_server(argv[2], outputMode, numThreads, preludePath);
 	} else {
-		return run(is, argv[1], outputMode);
+		return run(is, argv[1], outputMode, std::cout, std::cerr);
 	}
 }
@@ -2,17 +2,28 @@
 
 #include "../Value.h"
 
+class MemoTable;
+
 class VFun : public Value {
 public:
 	const Expr* fun;
+	// static type recorded on fun by the type checker (copies and substitutions keep it)
+	const Type* type;
+	// results cache, if this function came from a memoized fix expression
+	MemoTable* memo = nullptr;
 
-	VFun(const Expr* fun) : fun(fun) {}
+	VFun(const Expr* fun) : fun(fun), type(fun->synType) {}
 
 	void print(std::ostream& os) const override {
 		os << fun;
 	}
 
 	const Type* get_type() const override {
-		return fun->type_syn(Context<const Type*>());
+		if (type) {
+			return type;
+		}
+		// only reachable for functions that never went through the type checker
+		Context<const Type*> typeCtx;
+		return fun->type_syn(typeCtx, false);
 	}
 };
@@ -1,18 +1,122 @@
 #pragma once
 
+#include <climits>
+#include <stdexcept>
 #include "../Value.h"
+#include "../BigInt.h"
 
+// an int is a long long until arithmetic overflows it, and then a BigInt
+// the operations check for overflow with the compiler's builtins, so the
+// common case costs one flag test more than plain long long arithmetic
 class VInt : public Value {
 public:
 	long long value;
+	// set only if the value does not fit in a long long (value is then 0)
+	const BigInt* big = nullptr;
 
-	VInt(long long value) : value(value) {}
+	VInt(long long value, const BigInt* big = nullptr) : value(value), big(big) {}
+
+	// a result that fits in a long long is kept as one
+	VInt(const BigInt& value) : value(0) {
+		if (value.fits_long_long()) {
+			this->value = value.to_long_long();
+		} else {
+			big = new BigInt(value);
+		}
+	}
+
+	BigInt to_big() const {
+		return big ? *big : BigInt(value);
+	}
+
+	// the value, for callers that expect a long long (value alone is 0 for a
+	// big one); throws std::overflow_error if it does not fit
+	long long to_long_long() const {
+		if (big) {
+			throw std::overflow_error(big->to_string() + " does not fit in a long long");
+		}
+		return value;
+	}
+
+	static Value* negate(const VInt* v) {
+		long long result;
+		if (!v->big && !__builtin_sub_overflow(0, v->value, &result)) {
+			return new VInt(result);
+		}
+		return new VInt(-v->to_big());
+	}
+
+	static Value* add(const VInt* l, const VInt* r) {
+		long long result;
+		if (!l->big && !r->big && !__builtin_add_overflow(l->value, r->value, &result)) {
+			return new VInt(result);
+		}
+		return new VInt(l->to_big() + r->to_big());
+	}
+
+	static Value* subtract(const VInt* l, const VInt* r) {
+		long long result;
+		if (!l->big && !r->big && !__builtin_sub_overflow(l->value, r->value, &result)) {
+			return new VInt(result);
+		}
+		return new VInt(l->to_big() - r->to_big());
+	}
+
+	static Value* multiply(const VInt* l, const VInt* r) {
+		long long result;
+		if (!l->big && !r->big && !__builtin_mul_overflow(l->value, r->value, &result)) {
+			return new VInt(result);
+		}
+		return new VInt(l->to_big() * r->to_big());
+	}
+
+	// LLONG_MIN / -1 is the only long long division that overflows
+	// a zero divisor throws std::runtime_error, as BigInt division does (a big
+	// value is never zero)
+	static Value* divide(const VInt* l, const VInt* r) {
+		check_divisor(r);
+		if (!l->big && !r->big && (r->value != -1 || l->value != LLONG_MIN)) {
+			return new VInt(l->value / r->value);
+		}
+		return new VInt(l->to_big() / r->to_big());
+	}
+
+	static Value* modulo(const VInt* l, const VInt* r) {
+		check_divisor(r);
+		if (!l->big && !r->big && (r->value != -1 || l->value != LLONG_MIN)) {
+			return new VInt(l->value % r->value);
+		}
+		return new VInt(l->to_big() % r->to_big());
+	}
+
+	// a big value never equals a long long one, since results are kept small
+	// whenever they fit
+	static bool equals(const VInt* l, const VInt* r) {
+		if (!l->big && !r->big) { return l->value == r->value; }
+		return l->big && r->big && *l->big == *r->big;
+	}
+
+	static bool less(const VInt* l, const VInt* r) {
+		if (!l->big && !r->big) { return l->value < r->value; }
+		return l->to_big() < r->to_big();
+	}
 
 	void print(std::ostream& os) const override {
-		os << value;
+		if (big) {
+			os << big->to_string();
+		} else {
+			os << value;
+		}
 	}
 
 	const Type* get_type() const override {
 		return Type::Int();
 	}
+
+private:
+	static void check_divisor(const VInt* r) {
+		if (!r->big && r->value == 0) {
+			throw std::runtime_error("Division by zero");
+		}
+	}
 };
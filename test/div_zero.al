@@ -0,0 +1,3 @@
+(* division by zero is an error, not a crash *)
+let n = 7 in
+n / (n - 7)
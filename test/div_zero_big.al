@@ -0,0 +1,3 @@
+(* the same error once the dividend no longer fits in a long long *)
+let n = 100000000000000000000 in
+n % (n - n)
@@ -0,0 +1,2 @@
+let f = 5 in
+f + ((fix (f : int -> int) -> fun (x : int) -> if x < 1 then 0 else f (x - 1)) 3)
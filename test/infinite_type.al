@@ -0,0 +1,2 @@
+(* a function applied to itself has no finite type *)
+fun x -> x x
@@ -0,0 +1,2 @@
+(* inlining keeps call by value: the unused argument still fails *)
+(fun (x : int) -> 3) (1 / 0)
@@ -0,0 +1,3 @@
+(* an operand of unknown type is decided by the uses of its function *)
+let add = fun a -> fun b -> a + b in
+add 1.5 2.5
@@ -0,0 +1,85 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <functional>
+#include <unordered_map>
+
+// synthetic AL program generator for front-end scaling tests
+// usage: algen SHAPE N
+// prints a well-typed program whose size grows linearly with N
+//   let-chain   N sequential lets, each using the previous binding
+//   wide-op     one expression with N operands of mixed binary operators
+//   nested-fun  N nested annotated funs, applied to N arguments
+//   records     N record type declarations, one of them used
+//   comments    a comment block of N lines (with nested comments)
+
+namespace {
+
+void let_chain(std::ostream& os, int n) {
+	os << "let x0 = 1 in\n";
+	for (int i = 1; i < n; ++i) {
+		os << "let x" << i << " = x" << i - 1 << " + " << i % 10 << " in\n";
+	}
+	os << "x" << n - 1 << "\n";
+}
+
+void wide_op(std::ostream& os, int n) {
+	static const char* ops[] = { " + ", " * ", " - ", " / " };
+	os << "1";
+	for (int i = 1; i < n; ++i) {
+		os << ops[i % 4] << i % 9 + 1;
+		if (i % 16 == 0) {
+			os << "\n";
+		}
+	}
+	os << "\n";
+}
+
+void nested_fun(std::ostream& os, int n) {
+	os << "(";
+	for (int i = 0; i < n; ++i) {
+		os << "fun (a" << i << " : int) ->\n";
+	}
+	os << "a0 + a" << n - 1 << ")";
+	for (int i = 0; i < n; ++i) {
+		os << " " << i;
+	}
+	os << "\n";
+}
+
+void records(std::ostream& os, int n) {
+	for (int i = 0; i < n; ++i) {
+		os << "type r" << i << " = { a: int, b: bool, c: float };\n";
+	}
+	os << "let r = ({ a = 1, b = true, c = 2.0 } : r" << n - 1 << ") in 1\n";
+}
+
+void comments(std::ostream& os, int n) {
+	os << "(* generated comment block\n";
+	for (int i = 1; i < n; ++i) {
+		if (i % 8 == 0) {
+			os << "(* nested comment " << i << " *)\n";
+		} else {
+			os << "line " << i << ": let x = fun y -> y in x * 2 + 1\n";
+		}
+	}
+	os << "*)\n1\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	const std::unordered_map<std::string, std::function<void(std::ostream&, int)>> shapes = {
+		{ "let-chain", let_chain },
+		{ "wide-op", wide_op },
+		{ "nested-fun", nested_fun },
+		{ "records", records },
+		{ "comments", comments },
+	};
+	if (argc != 3 || !shapes.count(argv[1]) || atoi(argv[2]) < 1) {
+		std::cerr << "Usage: algen let-chain|wide-op|nested-fun|records|comments N" << std::endl;
+		return 1;
+	}
+	shapes.at(argv[1])(std::cout, atoi(argv[2]));
+	return 0;
+}